@@ -671,6 +671,19 @@ NRSC5_API void nrsc5_program_type_name(unsigned int type, const char **name);
  * not recognized, it will be the string "Unknown".
  */
  NRSC5_API void nrsc5_alert_category_name(unsigned int category, const char **name);
+
+/**
+ * Sets the file used to store FFTW wisdom.
+ * @param[in] path  path of the wisdom file, or NULL to stop using one
+ * @return 0 on success, or nonzero if the file exists but could not be read
+ *
+ * Wisdom in the file is loaded immediately. FFT plans are shared by all
+ * sessions in the process and are created when the first session is opened,
+ * so this should be called before any `open_` command. With a wisdom file,
+ * plans are searched for more thoroughly, and the wisdom is saved back to
+ * the file so that later runs can skip the search.
+ */
+NRSC5_API int nrsc5_set_fftw_wisdom_file(const char *path);
  
  /**
  * Initializes a session for a particular RTLSDR radio dongle.
@@ -740,7 +753,8 @@ NRSC5_API void nrsc5_start(nrsc5_t *st);
  * Signals the worker to *stop* demodulation.
  * @param[in] st  pointer to an `nrsc5_t` session object
  *
- * This function will block until the worker is stopped.
+ * This function will block until the worker is stopped and all demodulated
+ * data has been decoded.
  */
 NRSC5_API void nrsc5_stop(nrsc5_t *st);
 
@@ -750,9 +764,35 @@ NRSC5_API void nrsc5_stop(nrsc5_t *st);
  * @param[in] mode  either `NRSC5_MODE_FM` or `NRSC5_MODE_AM`
  * @return 0 on success or nonzero on error.
  *
+ * This function may only be called when the device is **stopped**.
+ * Input is reset.
  */
 NRSC5_API int nrsc5_set_mode(nrsc5_t *st, int mode);
 
+/**
+ * Set the number of threads used to decode the P1 logical channel.
+ * @param[in] st  pointer to an `nrsc5_t` session object
+ * @param[in] threads  number of threads, 1 (the default) for none
+ * @return 0 on success or nonzero on error.
+ *
+ * Each P1 frame is split into this many segments, which are decoded in
+ * parallel. This function must be called while the worker is stopped.
+ */
+NRSC5_API int nrsc5_set_fec_threads(nrsc5_t *st, int threads);
+
+/**
+ * Set how often the bit error rate is measured.
+ * @param[in] st  pointer to an `nrsc5_t` session object
+ * @param[in] interval  report `NRSC5_EVENT_BER` once every this many P1
+ *                      frames, or 0 to disable (the default is 1)
+ * @return 0 on success or nonzero on error.
+ *
+ * Measuring the bit error rate requires re-encoding each decoded frame.
+ * This function may be called at any time, including while the worker is
+ * running. The new interval applies to frames decoded after the call.
+ */
+NRSC5_API int nrsc5_set_ber_interval(nrsc5_t *st, unsigned int interval);
+
 /**
  * Enable or disable the bias-T for the radio.
  * @param[in] st  pointer to an `nrsc5_t` session object
@@ -843,6 +883,8 @@ NRSC5_API void nrsc5_set_auto_gain(nrsc5_t *st, int enabled);
  * @param[in] callback  pointer to an event handling function of two arguments
  * @param[in] opaque    pointer to the function's intended 2nd argument
  *
+ * Events are reported from the demodulator and from a separate decoding
+ * thread, but the callback is never invoked concurrently.
  */
 NRSC5_API void nrsc5_set_callback(nrsc5_t *st, nrsc5_callback_t callback, void *opaque);
 
@@ -855,6 +897,8 @@ NRSC5_API void nrsc5_set_callback(nrsc5_t *st, nrsc5_callback_t callback, void *
  * @see NRSC5_SAMPLE_RATE_CU8 for required sample rate
  * @return 0 on success, nonzero on error
  *
+ * Decoding happens on a separate thread, so events may be reported after
+ * this function returns. Call nrsc5_stop() to wait for them.
  */
 NRSC5_API int nrsc5_pipe_samples_cu8(nrsc5_t *st, const uint8_t *samples, unsigned int length);
 
@@ -867,6 +911,8 @@ NRSC5_API int nrsc5_pipe_samples_cu8(nrsc5_t *st, const uint8_t *samples, unsign
  * @see NRSC5_SAMPLE_RATE_CS16_FM & NRSC5_SAMPLE_RATE_CS16_AM for required sample rate
  * @return 0 on success, nonzero on error
  *
+ * Decoding happens on a separate thread, so events may be reported after
+ * this function returns. Call nrsc5_stop() to wait for them.
  */
 NRSC5_API int nrsc5_pipe_samples_cs16(nrsc5_t *st, const int16_t *samples, unsigned int length);
 
@@ -20,11 +20,21 @@
 #include "defines.h"
 #include "input.h"
 #include "private.h"
+#include "vmath.h"
 
 #define FILTER_DELAY 15
 #define DECIMATION_FACTOR_FM 2
 #define DECIMATION_FACTOR_AM 32
 
+/*
+ * The FFT plans are shared by all sessions, and executed on each session's
+ * own buffers. They are created by the first acquire_init() and destroyed
+ * by the last acquire_free(), under fftw_mutex.
+ */
+static fftwf_plan fft_plan_fm;
+static fftwf_plan fft_plan_am;
+static unsigned int fft_plan_refs;
+
 static float filter_taps_fm[] = {
     -0.000685643230099231,
     0.005636964458972216,
@@ -95,6 +105,204 @@ static float filter_taps_am[] = {
     0
 };
 
+// add the correlations of samples i to n - 1 with the samples fft later
+static void accumulate(acquire_t *st, unsigned int i, unsigned int n)
+{
+    unsigned int phase;
+
+    if (n > (unsigned int)st->fftcp * ACQUIRE_SYMBOLS)
+        n = st->fftcp * ACQUIRE_SYMBOLS;
+
+    for (phase = i % st->fftcp; i < n; i++)
+    {
+        st->sums[phase] += st->filtered[i] * conjf(st->filtered[i + st->fft]);
+        if (++phase == (unsigned int)st->fftcp)
+            phase = 0;
+    }
+}
+
+/*
+ * Filter the samples pushed since the last call and add their cyclic
+ * prefix correlations to the running sums. The correlation of sample n
+ * with sample n + fft is only known once the later sample has arrived.
+ */
+static void correlate(acquire_t *st)
+{
+    cint16_t y[FFTCP_FM];
+    unsigned int i, n;
+
+    while (st->corr_idx < st->idx)
+    {
+        n = st->idx - st->corr_idx;
+        if (n > FFTCP_FM)
+            n = FFTCP_FM;
+
+        fir_q15_execute_block((st->mode == NRSC5_MODE_FM) ? st->filter_fm : st->filter_am, &st->in_buffer[st->corr_idx], y, n);
+        for (i = 0; i < n; i++)
+            st->filtered[st->corr_idx + i] = (st->mode == NRSC5_MODE_FM) ? cq15_to_cf_conj(y[i]) : cq15_to_cf(y[i]);
+
+        if (st->corr_idx + n > (unsigned int)st->fft)
+            accumulate(st, (st->corr_idx > (unsigned int)st->fft) ? st->corr_idx - st->fft : 0, st->corr_idx + n - st->fft);
+        st->corr_idx += n;
+    }
+}
+
+/*
+ * Drop the first 'shift' samples from the correlator, keeping the filtered
+ * samples that are still buffered and rebuilding the sums from them.
+ */
+static void correlate_shift(acquire_t *st, unsigned int shift)
+{
+    memset(st->sums, 0, sizeof(float complex) * st->fftcp);
+
+    if (st->corr_idx < shift)
+    {
+        st->corr_idx = 0;
+        return;
+    }
+
+    st->corr_idx -= shift;
+    memmove(&st->filtered[0], &st->filtered[shift], sizeof(float complex) * st->corr_idx);
+    if (st->corr_idx > (unsigned int)st->fft)
+        accumulate(st, 0, st->corr_idx - st->fft);
+}
+
+/*
+ * Numerically controlled oscillator, advanced NCO_BLOCK samples at a time.
+ * Each block is rotated by the phase at its start times a table of powers
+ * of the phase increment, so the samples of a block are independent.
+ */
+#define NCO_BLOCK 16
+
+typedef struct
+{
+    float complex phase;
+    // phase_increment^k * (-1)^k, for k = 0 to NCO_BLOCK
+    float re[NCO_BLOCK + 1];
+    float im[NCO_BLOCK + 1];
+} nco_t;
+
+static void nco_init(nco_t *nco, float complex phase, float complex phase_increment)
+{
+    float complex step = 1;
+    int k;
+
+    nco->phase = phase;
+    for (k = 0; k <= NCO_BLOCK; k++)
+    {
+        nco->re[k] = (k & 1) ? -crealf(step) : crealf(step);
+        nco->im[k] = (k & 1) ? -cimagf(step) : cimagf(step);
+        step *= phase_increment;
+    }
+}
+
+// rotate, weight and store or add 'm' samples, the first of which is scaled by 'sign'
+static inline void nco_block(nco_t *nco, const cint16_t *x, float conj, const float *shape,
+                             float *restrict out, float sign, unsigned int m, int add)
+{
+    const float *restrict re = nco->re;
+    const float *restrict im = nco->im;
+    const float pr = crealf(nco->phase) * sign;
+    const float pi = cimagf(nco->phase) * sign;
+    unsigned int k;
+
+    for (k = 0; k < m; k++)
+    {
+        const float wr = pr * re[k] - pi * im[k];
+        const float wi = pr * im[k] + pi * re[k];
+        const float xr = x[k].r;
+        const float xi = x[k].i * conj;
+        const float w = shape ? shape[k] : 1.0f;
+        const float vr = (xr * wr - xi * wi) * w;
+        const float vi = (xr * wi + xi * wr) * w;
+
+        if (add)
+        {
+            out[2 * k] += vr;
+            out[2 * k + 1] += vi;
+        }
+        else
+        {
+            out[2 * k] = vr;
+            out[2 * k + 1] = vi;
+        }
+    }
+
+    nco->phase *= (m & 1) ? -CMPLXF(re[m], im[m]) : CMPLXF(re[m], im[m]);
+}
+
+/*
+ * Convert 'n' Q15 samples to float, rotate them by the NCO, weight them by
+ * 'shape' (if not NULL) and store or add them at 'dst' in 'y'. Samples are
+ * negated at odd positions of 'y', which swaps the halves of the FFT output
+ * so that DC lands in the middle.
+ */
+static inline void nco_window(nco_t *nco, const cint16_t *x, float conj, const float *shape,
+                              float complex *y, unsigned int dst, unsigned int n, int add)
+{
+    const float sign = (dst & 1) ? -1.0f / 32767.0f : 1.0f / 32767.0f;
+    float *out = (float *)&y[dst];
+    unsigned int j;
+
+    for (j = 0; j + NCO_BLOCK <= n; j += NCO_BLOCK)
+        nco_block(nco, &x[j], conj, shape ? &shape[j] : NULL, &out[2 * j], sign, NCO_BLOCK, add);
+    if (j < n)
+        nco_block(nco, &x[j], conj, shape ? &shape[j] : NULL, &out[2 * j], sign, n - j, add);
+}
+
+/*
+ * Apply the pulse shape and frequency correction to each symbol, starting
+ * 'samperr' samples into the input buffer, and lay them out one after
+ * another for a single batched FFT. Within a symbol, sample j goes to
+ * (j + offset) % fft, which is written as three runs plus the overlapping
+ * tail of the cyclic prefix.
+ */
+static void window_symbols(acquire_t *st, int samperr, float complex *phase, float complex phase_increment)
+{
+    const unsigned int offset = (st->mode == NRSC5_MODE_FM) ? 0 : (FFT_AM - CP_AM) / 2;
+    const float conj = (st->mode == NRSC5_MODE_FM) ? -1.0f : 1.0f;
+    const unsigned int fft = st->fft, cp = st->cp;
+    nco_t nco;
+    int i;
+
+    nco_init(&nco, *phase, phase_increment);
+
+    for (i = 0; i < ACQUIRE_SYMBOLS; ++i)
+    {
+        const cint16_t *x = &st->in_buffer[i * st->fftcp + samperr];
+        float complex *fftin = &st->fftin[i * fft];
+
+        nco_window(&nco, x, conj, st->shape, fftin, offset, cp, 0);
+        nco_window(&nco, x + cp, conj, NULL, fftin, offset + cp, fft - offset - cp, 0);
+        nco_window(&nco, x + fft - offset, conj, NULL, fftin, 0, offset, 0);
+        nco_window(&nco, x + fft, conj, st->shape + fft, fftin, offset, cp, 1);
+
+        nco.phase /= cabsf(nco.phase);
+    }
+
+    *phase = nco.phase;
+}
+
+/*
+ * Middle bin of the FFT of a symbol laid out by window_symbols(). As the
+ * inputs at odd positions are negated, this is their alternating sum.
+ */
+static float complex center_bin(const float complex *x, int n)
+{
+    float even_r = 0, even_i = 0, odd_r = 0, odd_i = 0;
+    int k;
+
+    for (k = 0; k < n; k += 2)
+    {
+        even_r += crealf(x[k]);
+        even_i += cimagf(x[k]);
+        odd_r += crealf(x[k + 1]);
+        odd_i += cimagf(x[k + 1]);
+    }
+
+    return CMPLXF(even_r - odd_r, even_i - odd_i);
+}
+
 void acquire_process(acquire_t *st)
 {
     float complex max_v = 0, phase_increment;
@@ -105,7 +313,7 @@ void acquire_process(acquire_t *st)
     if (st->idx != (unsigned int)st->fftcp * (ACQUIRE_SYMBOLS + 1))
         return;
 
-    output_advance(st->input->output);
+    decode_push_advance(&st->input->decode);
 
     if (st->input->sync_state == SYNC_STATE_FINE)
     {
@@ -119,27 +327,33 @@ void acquire_process(acquire_t *st)
     }
     else
     {
-        cint16_t y;
-        for (i = 0; i < st->fftcp * (ACQUIRE_SYMBOLS + 1); i++)
-        {
-            fir_q15_execute((st->mode == NRSC5_MODE_FM) ? st->filter_fm : st->filter_am, &st->in_buffer[i], &y);
-            st->buffer[i] = (st->mode == NRSC5_MODE_FM) ? cq15_to_cf_conj(y) : cq15_to_cf(y);
-        }
-
-        memset(st->sums, 0, sizeof(float complex) * st->fftcp);
-        for (i = 0; i < st->fftcp; ++i)
+        float complex rot, a = 0, b = 0;
+
+        correlate(st);
+
+        /*
+         * Smooth the sums with the pulse shape of the cyclic prefix,
+         * shape[j] * shape[j + fft] = sin(pi * j / cp) / 2. The window is
+         * split into two rotating sums, a with exp(i * pi * j / cp) and b
+         * with its conjugate. Since exp(i * pi) = -1, each slides along by
+         * one sample with a single rotation.
+         */
+        rot = cexpf(I * (float)M_PI / st->cp);
+        for (j = 0; j < st->cp; ++j)
         {
-            for (j = 0; j < ACQUIRE_SYMBOLS; ++j)
-                st->sums[i] += st->buffer[i + j * st->fftcp] * conjf(st->buffer[i + j * st->fftcp + st->fft]);
+            const float complex w = fast_cexpi((float)M_PI * j / st->cp);
+            a += st->sums[j] * w;
+            b += st->sums[j] * conjf(w);
         }
 
         for (i = 0; i < st->fftcp; ++i)
         {
             float mag;
-            float complex v = 0;
+            float complex v = (a - b) * (-0.25f * I);
+            float complex out = st->sums[i] + st->sums[(i + st->cp < st->fftcp) ? i + st->cp : i + st->cp - st->fftcp];
 
-            for (j = 0; j < st->cp; ++j)
-                v += st->sums[(i + j) % st->fftcp] * st->shape[j] * st->shape[j + st->fft];
+            a = (a - out) * conjf(rot);
+            b = (b - out) * rot;
 
             mag = normf(v);
             if (mag > max_mag)
@@ -157,9 +371,6 @@ void acquire_process(acquire_t *st)
         input_set_sync_state(st->input, SYNC_STATE_COARSE);
     }
 
-    for (i = 0; i < st->fftcp * (ACQUIRE_SYMBOLS + 1); i++)
-        st->buffer[i] = (st->mode == NRSC5_MODE_FM) ? cq15_to_cf_conj(st->in_buffer[i]) : cq15_to_cf(st->in_buffer[i]);
-
     sync_adjust(&st->input->sync, st->fftcp / 2 - samperr);
     angle -= 2 * M_PI * st->cfo;
 
@@ -170,51 +381,47 @@ void acquire_process(acquire_t *st)
     if (st->mode == NRSC5_MODE_AM)
     {
         float y, sum_y = 0, sum_xy = 0, sum_x2 = 0;
-        float complex last_carrier;
+        float complex carrier, last_carrier;
         float complex temp_phase = st->phase;
         float mag_sums[FFT_AM] = {0};
+        const int search = (st->input->sync_state != SYNC_STATE_FINE);
+
+        /*
+         * Only the carrier is needed to estimate the phase, unless the
+         * subcarriers are also searched for the frequency offset. So when
+         * in fine sync, skip the transform and take the middle bin alone.
+         */
+        window_symbols(st, samperr, &temp_phase, phase_increment);
+        if (search)
+            fftwf_execute_dft(fft_plan_am, st->fftin, st->fftout);
 
         for (i = 0; i < ACQUIRE_SYMBOLS; ++i)
         {
-            int offset = (st->mode == NRSC5_MODE_FM) ? 0 : (FFT_AM - CP_AM) / 2;
-            for (j = 0; j < st->fftcp; ++j)
-            {
-                float complex sample = temp_phase * st->buffer[i * st->fftcp + j + samperr];
-                if (j < st->cp)
-                    st->fftin[(j + offset) % st->fft] = st->shape[j] * sample;
-                else if (j < st->fft)
-                    st->fftin[(j + offset) % st->fft] = sample;
-                else
-                    st->fftin[(j + offset) % st->fft] += st->shape[j] * sample;
-
-                temp_phase *= phase_increment;
-            }
-            temp_phase /= cabsf(temp_phase);
+            const float complex *fftout = &st->fftout[i * st->fft];
 
-            fftwf_execute((st->mode == NRSC5_MODE_FM) ? st->fft_plan_fm : st->fft_plan_am);
-            fftshift(st->fftout, st->fft);
+            carrier = search ? fftout[CENTER_AM] : center_bin(&st->fftin[i * st->fft], st->fft);
 
             float x = st->fftcp * (i - (float) (ACQUIRE_SYMBOLS - 1) / 2);
             if (i == 0)
-                y = cargf(st->fftout[CENTER_AM]);
+                y = cargf(carrier);
             else
-                y += cargf(st->fftout[CENTER_AM] / last_carrier);
-            last_carrier = st->fftout[CENTER_AM];
+                y += cargf(carrier / last_carrier);
+            last_carrier = carrier;
 
             sum_y += y;
             sum_xy += x * y;
             sum_x2 += x * x;
 
-            if (st->input->sync_state != SYNC_STATE_FINE)
+            if (search)
             {
                 for (j = CENTER_AM - PIDS_OUTER_INDEX_AM; j <= CENTER_AM + PIDS_OUTER_INDEX_AM; j++)
                 {
-                    mag_sums[j] += cabsf(st->fftout[j]);
+                    mag_sums[j] += sqrtf(normf(fftout[j]));
                 }
             }
         }
 
-        if (st->input->sync_state != SYNC_STATE_FINE)
+        if (search)
         {
             float max_mag = -1.0f;
             int max_index = -1;
@@ -234,31 +441,14 @@ void acquire_process(acquire_t *st)
         st->phase *= cexpf((-sum_y / ACQUIRE_SYMBOLS + (sum_xy / sum_x2)*(ACQUIRE_SYMBOLS)*st->fftcp/2 - 0.06) * I);
     }
 
-    for (i = 0; i < ACQUIRE_SYMBOLS; ++i)
-    {
-        int offset = (st->mode == NRSC5_MODE_FM) ? 0 : (FFT_AM - CP_AM) / 2;
-        for (j = 0; j < st->fftcp; ++j)
-        {
-            float complex sample = st->phase * st->buffer[i * st->fftcp + j + samperr];
-            if (j < st->cp)
-                st->fftin[(j + offset) % st->fft] = st->shape[j] * sample;
-            else if (j < st->fft)
-                st->fftin[(j + offset) % st->fft] = sample;
-            else
-                st->fftin[(j + offset) % st->fft] += st->shape[j] * sample;
-
-            st->phase *= phase_increment;
-        }
-        st->phase /= cabsf(st->phase);
-
-        fftwf_execute((st->mode == NRSC5_MODE_FM) ? st->fft_plan_fm : st->fft_plan_am);
-        fftshift(st->fftout, st->fft);
-        sync_push(&st->input->sync, st->fftout);
-    }
+    window_symbols(st, samperr, &st->phase, phase_increment);
+    fftwf_execute_dft((st->mode == NRSC5_MODE_FM) ? fft_plan_fm : fft_plan_am, st->fftin, st->fftout);
+    sync_push(&st->input->sync, st->fftout, ACQUIRE_SYMBOLS);
 
     keep = st->fftcp + (st->fftcp / 2 - samperr) + st->keep_extra;
     st->keep_extra = 0;
     memmove(&st->in_buffer[0], &st->in_buffer[st->idx - keep], sizeof(cint16_t) * keep);
+    correlate_shift(st, st->idx - keep);
     st->idx = keep;
 }
 
@@ -284,6 +474,9 @@ unsigned int acquire_push(acquire_t *st, const cint16_t *buf, const unsigned int
     memcpy(&st->in_buffer[st->idx], buf, sizeof(cint16_t) * pushed);
     st->idx += pushed;
 
+    if (st->input->sync_state != SYNC_STATE_FINE)
+        correlate(st);
+
     return pushed;
 }
 
@@ -292,6 +485,8 @@ void acquire_reset(acquire_t *st)
     firdecim_q15_reset(st->filter_fm);
     firdecim_q15_reset(st->filter_am);
     st->idx = 0;
+    st->corr_idx = 0;
+    memset(st->sums, 0, sizeof(st->sums));
     st->prev_angle = 0;
     st->phase = 1;
     st->keep_extra = 0;
@@ -313,10 +508,21 @@ void acquire_init(acquire_t *st, input_t *input)
     st->filter_am = firdecim_q15_create(filter_taps_am, sizeof(filter_taps_am) / sizeof(filter_taps_am[0]));
 
     pthread_mutex_lock(&fftw_mutex);
-    st->fftin = fftwf_alloc_complex(FFT_FM);
-    st->fftout = fftwf_alloc_complex(FFT_FM);
-    st->fft_plan_fm = fftwf_plan_dft_1d(FFT_FM, st->fftin, st->fftout, FFTW_FORWARD, FFTW_ESTIMATE);
-    st->fft_plan_am = fftwf_plan_dft_1d(FFT_AM, st->fftin, st->fftout, FFTW_FORWARD, FFTW_ESTIMATE);
+    st->fftin = fftwf_alloc_complex(FFT_FM * ACQUIRE_SYMBOLS);
+    st->fftout = fftwf_alloc_complex(FFT_FM * ACQUIRE_SYMBOLS);
+    if (fft_plan_refs++ == 0)
+    {
+        // planning is slow, so only be patient if the result can be saved
+        const unsigned int flags = fftw_wisdom_file ? FFTW_PATIENT : FFTW_MEASURE;
+
+        fft_plan_fm = fftwf_plan_many_dft(1, (int[]){ FFT_FM }, ACQUIRE_SYMBOLS, st->fftin, NULL, 1, FFT_FM,
+                                          st->fftout, NULL, 1, FFT_FM, FFTW_FORWARD, flags);
+        fft_plan_am = fftwf_plan_many_dft(1, (int[]){ FFT_AM }, ACQUIRE_SYMBOLS, st->fftin, NULL, 1, FFT_AM,
+                                          st->fftout, NULL, 1, FFT_AM, FFTW_FORWARD, flags);
+
+        if (fftw_wisdom_file && !fftwf_export_wisdom_to_filename(fftw_wisdom_file))
+            log_warn("Unable to save FFTW wisdom to %s", fftw_wisdom_file);
+    }
     pthread_mutex_unlock(&fftw_mutex);
 
     for (i = 0; i < FFTCP_FM; ++i)
@@ -372,8 +578,11 @@ void acquire_free(acquire_t *st)
     firdecim_q15_free(st->filter_am);
 
     pthread_mutex_lock(&fftw_mutex);
-    fftwf_destroy_plan(st->fft_plan_fm);
-    fftwf_destroy_plan(st->fft_plan_am);
+    if (--fft_plan_refs == 0)
+    {
+        fftwf_destroy_plan(fft_plan_fm);
+        fftwf_destroy_plan(fft_plan_am);
+    }
     fftwf_free(st->fftin);
     fftwf_free(st->fftout);
     pthread_mutex_unlock(&fftw_mutex);
@@ -10,17 +10,16 @@ typedef struct
     firdecim_q15 filter_fm;
     firdecim_q15 filter_am;
     cint16_t in_buffer[FFTCP_FM * (ACQUIRE_SYMBOLS + 1)];
-    float complex buffer[FFTCP_FM * (ACQUIRE_SYMBOLS + 1)];
+    float complex filtered[FFTCP_FM * (ACQUIRE_SYMBOLS + 1)];
     float complex sums[FFTCP_FM];
     float complex *fftin;
     float complex *fftout;
     float *shape;
     float shape_fm[FFTCP_FM];
     float shape_am[FFTCP_AM];
-    fftwf_plan fft_plan_fm;
-    fftwf_plan fft_plan_am;
 
     unsigned int idx;
+    unsigned int corr_idx;
     float prev_angle;
     float complex phase;
     int keep_extra;
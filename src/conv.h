@@ -15,7 +15,8 @@ enum {
  * k    - Constraint length (5 or 7)
  * rgen - Recursive generator polynomial in octal
  * gen  - Generator polynomials in octal
- * punc - Puncturing matrix (-1 terminated)
+ * punc - Puncturing pattern repeated over the frame, 1 for transmitted
+ *        and 0 for punctured bits (-1 terminated, NULL for none)
  * term - Termination type (zero flush default)
  */
 struct lte_conv_code {
@@ -24,14 +25,21 @@ struct lte_conv_code {
 	int len;
 	unsigned rgen;
 	unsigned gen[4];
-	int *punc;
+	const int *punc;
 	int term;
 };
 
-int nrsc5_conv_decode_p1(const int8_t *in, uint8_t *out);
-int nrsc5_conv_decode_pids(const int8_t *in, uint8_t *out);
-int nrsc5_conv_decode_p3_p4(const int8_t *in, uint8_t *out, int len);
-int nrsc5_conv_decode_e1(const int8_t *in, uint8_t *out, int len);
-int nrsc5_conv_decode_e2_e3(const int8_t *in, uint8_t *out, int len);
+struct vdecoder;
+
+struct vdecoder *nrsc5_conv_alloc_p1(void);
+struct vdecoder *nrsc5_conv_alloc_pids(void);
+struct vdecoder *nrsc5_conv_alloc_p3_p4(void);
+struct vdecoder *nrsc5_conv_alloc_e1(void);
+struct vdecoder *nrsc5_conv_alloc_e2(void);
+struct vdecoder *nrsc5_conv_alloc_e3(void);
+void nrsc5_conv_free(struct vdecoder *dec);
+int nrsc5_conv_set_threads(struct vdecoder *dec, int threads);
+int nrsc5_conv_decode(struct vdecoder *dec, const int8_t *in, uint8_t *out, int len);
+int nrsc5_conv_decode_batch(struct vdecoder *dec, const int8_t *in, uint8_t *out, int count, int len);
 
 #endif /* _CONV_H_ */
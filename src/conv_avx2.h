@@ -0,0 +1,195 @@
+/*
+ * Viterbi decoder for convolutional codes - Intel AVX2
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+/*
+ * The AVX2 kernels read the trellis outputs as N planes of num_states / 2
+ * values, so that 16 branch metrics can be computed with one load per
+ * output. Their kernel sets are marked with planar_outputs.
+ */
+
+/*
+ * Two lane deinterleaving
+ *
+ * Split 32 interleaved 16-bit path metrics into even and odd states. The
+ * values are sign extended to 32 bits in place and packed back, which
+ * leaves the 64-bit quarters out of order, so a cross-lane permute
+ * restores the state order.
+ *
+ * Input:
+ * M0:1 - Path metrics of 32 consecutive states
+ *
+ * Output:
+ * M2   - Path metrics of the 16 even states
+ * M3   - Path metrics of the 16 odd states
+ */
+#define AVX2_DEINTERLEAVE(M0,M1,M2,M3) \
+{ \
+	M2 = _mm256_packs_epi32(_mm256_srai_epi32(_mm256_slli_epi32(M0, 16), 16), \
+				_mm256_srai_epi32(_mm256_slli_epi32(M1, 16), 16)); \
+	M3 = _mm256_packs_epi32(_mm256_srai_epi32(M0, 16), \
+				_mm256_srai_epi32(M1, 16)); \
+	M2 = _mm256_permute4x64_epi64(M2, _MM_SHUFFLE(3, 1, 2, 0)); \
+	M3 = _mm256_permute4x64_epi64(M3, _MM_SHUFFLE(3, 1, 2, 0)); \
+}
+
+/*
+ * Generate branch metrics N = 3
+ *
+ * Compute 16 branch metrics from the planar trellis outputs and the
+ * broadcast soft input values.
+ *
+ * Input:
+ * M0:2 - Broadcast 16-bit input values
+ * O    - Trellis outputs, first plane
+ * H    - Plane stride (num_states / 2)
+ *
+ * Output:
+ * M3   - 16 computed 16-bit branch metrics
+ */
+#define AVX2_BRANCH_METRIC_N3(M0,M1,M2,O,H,M3) \
+{ \
+	M3 = _mm256_adds_epi16( \
+		_mm256_sign_epi16(M0, _mm256_loadu_si256((__m256i *) &(O)[0])), \
+		_mm256_sign_epi16(M1, _mm256_loadu_si256((__m256i *) &(O)[H]))); \
+	M3 = _mm256_adds_epi16(M3, \
+		_mm256_sign_epi16(M2, _mm256_loadu_si256((__m256i *) &(O)[2 * (H)]))); \
+}
+
+/*
+ * Hexadeca-Viterbi butterfly
+ *
+ * Compute 16-wide butterfly generating 32 path decisions and 32 accumulated
+ * sums.
+ *
+ * Input:
+ * M0 - Even state path metrics (packed 16-bit integers)
+ * M1 - Odd state path metrics (packed 16-bit integers)
+ * M2 - Branch metrics (packed 16-bit integers)
+ *
+ * Output:
+ * M3 - Selected and accumulated path metrics, lower half states
+ * M4 - Selected and accumulated path metrics, upper half states
+ * D  - Path decisions, lower half in bits 0-15, upper half in bits 16-31
+ */
+#define AVX2_BUTTERFLY(M0,M1,M2,M3,M4,D) \
+{ \
+	__m256i _s0 = _mm256_adds_epi16(M0, M2); \
+	__m256i _s1 = _mm256_subs_epi16(M1, M2); \
+	__m256i _s2 = _mm256_subs_epi16(M0, M2); \
+	__m256i _s3 = _mm256_adds_epi16(M1, M2); \
+	M3 = _mm256_max_epi16(_s0, _s1); \
+	M4 = _mm256_max_epi16(_s2, _s3); \
+	_s0 = _mm256_packs_epi16(_mm256_cmpgt_epi16(_s0, _s1), \
+				 _mm256_cmpgt_epi16(_s2, _s3)); \
+	_s0 = _mm256_permute4x64_epi64(_s0, _MM_SHUFFLE(3, 1, 2, 0)); \
+	D = (uint32_t) _mm256_movemask_epi8(_s0); \
+}
+
+/*
+ * Horizontal minimum
+ *
+ * Compute the minimum of packed signed 16-bit integers and place the result
+ * in the low 16-bit element. This is a destructive operation and the source
+ * register is overwritten.
+ */
+#define AVX2_HMIN_EPI16(M0) \
+{ \
+	M0 = _mm_min_epi16(M0, _mm_shuffle_epi32(M0, _MM_SHUFFLE(1, 0, 3, 2))); \
+	M0 = _mm_min_epi16(M0, _mm_shuffle_epi32(M0, _MM_SHUFFLE(2, 3, 0, 1))); \
+	M0 = _mm_min_epi16(M0, _mm_shufflelo_epi16(M0, _MM_SHUFFLE(2, 3, 0, 1))); \
+}
+
+/*
+ * Combined BMU/PMU (N=3)
+ *
+ * Compute branch metrics followed by path metrics for a 64 or 256 state
+ * trellis, 16 butterflies at a time. New path metrics are kept apart from
+ * the accumulated sums until all butterflies have read them.
+ */
+static inline void _avx2_metrics_n3(int num_states, const int8_t *seq,
+				    const int16_t *out, int16_t *sums,
+				    uint8_t *paths, int norm)
+{
+	int i;
+	uint32_t bits;
+	uint16_t lo, hi;
+	const int half = num_states / 2;
+	__m256i new_sums[num_states / 16];
+	__m256i m0, m1, m2, m3, m4, m5, m6;
+	__m128i min;
+
+	/* (BMU) Broadcast soft input values */
+	m0 = _mm256_set1_epi16(seq[0]);
+	m1 = _mm256_set1_epi16(seq[1]);
+	m2 = _mm256_set1_epi16(seq[2]);
+
+	for (i = 0; i < half / 16; i++) {
+		/* (BMU) Compute branch metrics */
+		AVX2_BRANCH_METRIC_N3(m0, m1, m2, &out[16 * i], half, m3)
+
+		/* (PMU) Load and deinterleave accumulated path metrics */
+		m4 = _mm256_load_si256((__m256i *) &sums[32 * i]);
+		m5 = _mm256_load_si256((__m256i *) &sums[32 * i + 16]);
+		AVX2_DEINTERLEAVE(m4, m5, m6, m4)
+
+		/* (PMU) Butterflies */
+		AVX2_BUTTERFLY(m6, m4, m3, new_sums[i],
+			       new_sums[i + half / 16], bits)
+
+		lo = bits;
+		hi = bits >> 16;
+		memcpy(&paths[2 * i], &lo, sizeof(lo));
+		memcpy(&paths[half / 8 + 2 * i], &hi, sizeof(hi));
+	}
+
+	if (norm) {
+		m3 = new_sums[0];
+		for (i = 1; i < num_states / 16; i++)
+			m3 = _mm256_min_epi16(m3, new_sums[i]);
+
+		min = _mm_min_epi16(_mm256_castsi256_si128(m3),
+				    _mm256_extracti128_si256(m3, 1));
+		AVX2_HMIN_EPI16(min)
+		m3 = _mm256_broadcastw_epi16(min);
+
+		for (i = 0; i < num_states / 16; i++)
+			new_sums[i] = _mm256_subs_epi16(new_sums[i], m3);
+	}
+
+	for (i = 0; i < num_states / 16; i++)
+		_mm256_store_si256((__m256i *) &sums[16 * i], new_sums[i]);
+}
+
+#ifndef CONV_METRIC_8BIT
+static void gen_metrics_k7_n3(const int8_t *seq, const int16_t *out,
+		       int16_t *sums, uint8_t *paths, int norm)
+{
+	_avx2_metrics_n3(64, seq, out, sums, paths, norm);
+}
+#endif
+
+static void gen_metrics_k9_n3(const int8_t *seq, const int16_t *out,
+		       int16_t *sums, uint8_t *paths, int norm)
+{
+	_avx2_metrics_n3(256, seq, out, sums, paths, norm);
+}
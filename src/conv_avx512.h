@@ -0,0 +1,193 @@
+/*
+ * Viterbi decoder for convolutional codes - Intel AVX-512
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+/*
+ * The AVX-512 kernels read the trellis outputs as N planes of
+ * num_states / 2 values, so that 32 branch metrics can be computed with
+ * one load per output. Their kernel sets are marked with planar_outputs.
+ */
+
+/*
+ * Two lane deinterleaving
+ *
+ * Split 64 interleaved 16-bit path metrics into even and odd states with
+ * two-source word permutes.
+ *
+ * Input:
+ * M0:1 - Path metrics of 64 consecutive states
+ *
+ * Output:
+ * M2   - Path metrics of the 32 even states
+ * M3   - Path metrics of the 32 odd states
+ */
+#define AVX512_DEINTERLEAVE(M0,M1,M2,M3) \
+{ \
+	const __m512i _even = _mm512_set_epi16( \
+		62, 60, 58, 56, 54, 52, 50, 48, 46, 44, 42, 40, 38, 36, 34, 32, \
+		30, 28, 26, 24, 22, 20, 18, 16, 14, 12, 10, 8, 6, 4, 2, 0); \
+	const __m512i _odd = _mm512_add_epi16(_even, _mm512_set1_epi16(1)); \
+	M2 = _mm512_permutex2var_epi16(M0, _even, M1); \
+	M3 = _mm512_permutex2var_epi16(M0, _odd, M1); \
+}
+
+/*
+ * Generate branch metrics N = 3
+ *
+ * Compute 32 branch metrics from the planar trellis outputs and the
+ * broadcast soft input values. There is no AVX-512 sign instruction, but
+ * the trellis outputs are +1 or -1, so a low multiply is equivalent.
+ *
+ * Input:
+ * M0:2 - Broadcast 16-bit input values
+ * O    - Trellis outputs, first plane
+ * H    - Plane stride (num_states / 2)
+ *
+ * Output:
+ * M3   - 32 computed 16-bit branch metrics
+ */
+#define AVX512_BRANCH_METRIC_N3(M0,M1,M2,O,H,M3) \
+{ \
+	M3 = _mm512_adds_epi16( \
+		_mm512_mullo_epi16(M0, _mm512_loadu_si512(&(O)[0])), \
+		_mm512_mullo_epi16(M1, _mm512_loadu_si512(&(O)[H]))); \
+	M3 = _mm512_adds_epi16(M3, \
+		_mm512_mullo_epi16(M2, _mm512_loadu_si512(&(O)[2 * (H)]))); \
+}
+
+/*
+ * Dotriaconta-Viterbi butterfly
+ *
+ * Compute 32-wide butterfly generating 64 path decisions and 64
+ * accumulated sums.
+ *
+ * Input:
+ * M0 - Even state path metrics (packed 16-bit integers)
+ * M1 - Odd state path metrics (packed 16-bit integers)
+ * M2 - Branch metrics (packed 16-bit integers)
+ *
+ * Output:
+ * M3 - Selected and accumulated path metrics, lower half states
+ * M4 - Selected and accumulated path metrics, upper half states
+ * D0 - Path decisions, lower half states
+ * D1 - Path decisions, upper half states
+ */
+#define AVX512_BUTTERFLY(M0,M1,M2,M3,M4,D0,D1) \
+{ \
+	__m512i _s0 = _mm512_adds_epi16(M0, M2); \
+	__m512i _s1 = _mm512_subs_epi16(M1, M2); \
+	__m512i _s2 = _mm512_subs_epi16(M0, M2); \
+	__m512i _s3 = _mm512_adds_epi16(M1, M2); \
+	M3 = _mm512_max_epi16(_s0, _s1); \
+	M4 = _mm512_max_epi16(_s2, _s3); \
+	D0 = _mm512_cmpgt_epi16_mask(_s0, _s1); \
+	D1 = _mm512_cmpgt_epi16_mask(_s2, _s3); \
+}
+
+/*
+ * Horizontal minimum
+ *
+ * Compute the minimum of packed signed 16-bit integers and place the result
+ * in the low 16-bit element. This is a destructive operation and the source
+ * register is overwritten.
+ */
+#define AVX512_HMIN_EPI16(M0) \
+{ \
+	M0 = _mm_min_epi16(M0, _mm_shuffle_epi32(M0, _MM_SHUFFLE(1, 0, 3, 2))); \
+	M0 = _mm_min_epi16(M0, _mm_shuffle_epi32(M0, _MM_SHUFFLE(2, 3, 0, 1))); \
+	M0 = _mm_min_epi16(M0, _mm_shufflelo_epi16(M0, _MM_SHUFFLE(2, 3, 0, 1))); \
+}
+
+/*
+ * Combined BMU/PMU (N=3)
+ *
+ * Compute branch metrics followed by path metrics for a 64 or 256 state
+ * trellis, 32 butterflies at a time. New path metrics are kept apart from
+ * the accumulated sums until all butterflies have read them.
+ */
+static inline void _avx512_metrics_n3(int num_states, const int8_t *seq,
+				      const int16_t *out, int16_t *sums,
+				      uint8_t *paths, int norm)
+{
+	int i;
+	__mmask32 lo, hi;
+	const int half = num_states / 2;
+	__m512i new_sums[num_states / 32];
+	__m512i m0, m1, m2, m3, m4, m5, m6;
+	__m256i m7;
+	__m128i min;
+
+	/* (BMU) Broadcast soft input values */
+	m0 = _mm512_set1_epi16(seq[0]);
+	m1 = _mm512_set1_epi16(seq[1]);
+	m2 = _mm512_set1_epi16(seq[2]);
+
+	for (i = 0; i < half / 32; i++) {
+		/* (BMU) Compute branch metrics */
+		AVX512_BRANCH_METRIC_N3(m0, m1, m2, &out[32 * i], half, m3)
+
+		/* (PMU) Load and deinterleave accumulated path metrics */
+		m4 = _mm512_load_si512((__m512i *) &sums[64 * i]);
+		m5 = _mm512_load_si512((__m512i *) &sums[64 * i + 32]);
+		AVX512_DEINTERLEAVE(m4, m5, m6, m4)
+
+		/* (PMU) Butterflies */
+		AVX512_BUTTERFLY(m6, m4, m3, new_sums[i],
+				 new_sums[i + half / 32], lo, hi)
+
+		memcpy(&paths[4 * i], &lo, sizeof(lo));
+		memcpy(&paths[half / 8 + 4 * i], &hi, sizeof(hi));
+	}
+
+	if (norm) {
+		m3 = new_sums[0];
+		for (i = 1; i < num_states / 32; i++)
+			m3 = _mm512_min_epi16(m3, new_sums[i]);
+
+		m7 = _mm256_min_epi16(_mm512_castsi512_si256(m3),
+				      _mm512_extracti64x4_epi64(m3, 1));
+		min = _mm_min_epi16(_mm256_castsi256_si128(m7),
+				    _mm256_extracti128_si256(m7, 1));
+		AVX512_HMIN_EPI16(min)
+		m3 = _mm512_broadcastw_epi16(min);
+
+		for (i = 0; i < num_states / 32; i++)
+			new_sums[i] = _mm512_subs_epi16(new_sums[i], m3);
+	}
+
+	for (i = 0; i < num_states / 32; i++)
+		_mm512_store_si512((__m512i *) &sums[32 * i], new_sums[i]);
+}
+
+#ifndef CONV_METRIC_8BIT
+static void gen_metrics_k7_n3(const int8_t *seq, const int16_t *out,
+		       int16_t *sums, uint8_t *paths, int norm)
+{
+	_avx512_metrics_n3(64, seq, out, sums, paths, norm);
+}
+#endif
+
+static void gen_metrics_k9_n3(const int8_t *seq, const int16_t *out,
+		       int16_t *sums, uint8_t *paths, int norm)
+{
+	_avx512_metrics_n3(256, seq, out, sums, paths, norm);
+}
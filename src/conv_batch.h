@@ -0,0 +1,190 @@
+/*
+ * Viterbi decoder for convolutional codes - batched codewords
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdint.h>
+
+#include "conv_kernels.h"
+
+#if defined(HAVE_AVX2)
+#include <immintrin.h>
+#elif defined(HAVE_SSE3)
+#include <emmintrin.h>
+#endif
+
+/*
+ * Branch metrics unit N=3 for a batch of codewords
+ *
+ * With three outputs of +1 or -1 there are only eight distinct branch
+ * metrics per step. Compute all of them, indexed by the trellis outputs
+ * with bit j set where output j is +1.
+ */
+static void batch_branch_metrics_n3(const int16_t *seq, int16_t *metrics)
+{
+	int l;
+
+	for (l = 0; l < CONV_BATCH_LANES; l++) {
+		const int16_t s0 = seq[l];
+		const int16_t s1 = seq[CONV_BATCH_LANES + l];
+		const int16_t s2 = seq[2 * CONV_BATCH_LANES + l];
+		const int16_t sum = s0 + s1;
+		const int16_t diff = s0 - s1;
+
+		metrics[7 * CONV_BATCH_LANES + l] = sum + s2;
+		metrics[3 * CONV_BATCH_LANES + l] = sum - s2;
+		metrics[5 * CONV_BATCH_LANES + l] = diff + s2;
+		metrics[1 * CONV_BATCH_LANES + l] = diff - s2;
+		metrics[0 * CONV_BATCH_LANES + l] = -(sum + s2);
+		metrics[4 * CONV_BATCH_LANES + l] = -(sum - s2);
+		metrics[2 * CONV_BATCH_LANES + l] = -(diff + s2);
+		metrics[6 * CONV_BATCH_LANES + l] = -(diff - s2);
+	}
+}
+
+/*
+ * Path metric unit for a batch of codewords
+ *
+ * Input:
+ * metrics - Branch metrics from batch_branch_metrics_n3()
+ * out     - Branch metric index of each butterfly
+ * sums    - Accumulated path metrics, one row per state
+ *
+ * Output:
+ * new_sums - Selected and accumulated path metrics
+ * paths    - Path decisions, one word per state
+ */
+#if defined(HAVE_AVX2)
+static void batch_path_metrics(int num_states, const int16_t *metrics,
+			       const uint8_t *out, const int16_t *sums,
+			       int16_t *new_sums, uint16_t *paths)
+{
+	int i;
+	uint32_t bits;
+	const int half = num_states / 2;
+	__m256i m0, m1, m2, m3, m4, m5, m6;
+
+	for (i = 0; i < half; i++) {
+		m0 = _mm256_loadu_si256((__m256i *) &metrics[out[i] * 16]);
+		m1 = _mm256_loadu_si256((__m256i *) &sums[(2 * i + 0) * 16]);
+		m2 = _mm256_loadu_si256((__m256i *) &sums[(2 * i + 1) * 16]);
+
+		m3 = _mm256_add_epi16(m1, m0);
+		m4 = _mm256_sub_epi16(m2, m0);
+		m5 = _mm256_sub_epi16(m1, m0);
+		m6 = _mm256_add_epi16(m2, m0);
+
+		_mm256_storeu_si256((__m256i *) &new_sums[i * 16],
+				    _mm256_max_epi16(m3, m4));
+		_mm256_storeu_si256((__m256i *) &new_sums[(i + half) * 16],
+				    _mm256_max_epi16(m5, m6));
+
+		m3 = _mm256_packs_epi16(_mm256_cmpgt_epi16(m3, m4),
+					_mm256_cmpgt_epi16(m5, m6));
+		m3 = _mm256_permute4x64_epi64(m3, _MM_SHUFFLE(3, 1, 2, 0));
+		bits = (uint32_t) _mm256_movemask_epi8(m3);
+
+		paths[i] = bits;
+		paths[i + half] = bits >> 16;
+	}
+}
+#elif defined(HAVE_SSE3)
+static void batch_path_metrics(int num_states, const int16_t *metrics,
+			       const uint8_t *out, const int16_t *sums,
+			       int16_t *new_sums, uint16_t *paths)
+{
+	int i, j;
+	const int half = num_states / 2;
+	__m128i m0, m1, m2, m3, m4, m5, m6, d0[2], d1[2];
+
+	for (i = 0; i < half; i++) {
+		for (j = 0; j < 2; j++) {
+			m0 = _mm_loadu_si128((__m128i *) &metrics[out[i] * 16 + 8 * j]);
+			m1 = _mm_loadu_si128((__m128i *) &sums[(2 * i + 0) * 16 + 8 * j]);
+			m2 = _mm_loadu_si128((__m128i *) &sums[(2 * i + 1) * 16 + 8 * j]);
+
+			m3 = _mm_add_epi16(m1, m0);
+			m4 = _mm_sub_epi16(m2, m0);
+			m5 = _mm_sub_epi16(m1, m0);
+			m6 = _mm_add_epi16(m2, m0);
+
+			_mm_storeu_si128((__m128i *) &new_sums[i * 16 + 8 * j],
+					 _mm_max_epi16(m3, m4));
+			_mm_storeu_si128((__m128i *) &new_sums[(i + half) * 16 + 8 * j],
+					 _mm_max_epi16(m5, m6));
+
+			d0[j] = _mm_cmpgt_epi16(m3, m4);
+			d1[j] = _mm_cmpgt_epi16(m5, m6);
+		}
+
+		paths[i] = _mm_movemask_epi8(_mm_packs_epi16(d0[0], d0[1]));
+		paths[i + half] = _mm_movemask_epi8(_mm_packs_epi16(d1[0], d1[1]));
+	}
+}
+#else
+static void batch_path_metrics(int num_states, const int16_t *metrics,
+			       const uint8_t *out, const int16_t *sums,
+			       int16_t *new_sums, uint16_t *paths)
+{
+	int i, l;
+	const int half = num_states / 2;
+
+	for (i = 0; i < half; i++) {
+		const int16_t *m = &metrics[out[i] * CONV_BATCH_LANES];
+		const int16_t *s0 = &sums[(2 * i + 0) * CONV_BATCH_LANES];
+		const int16_t *s1 = &sums[(2 * i + 1) * CONV_BATCH_LANES];
+		uint16_t bits0 = 0, bits1 = 0;
+
+		for (l = 0; l < CONV_BATCH_LANES; l++) {
+			int16_t sum0 = s0[l] + m[l];
+			int16_t sum1 = s1[l] - m[l];
+			int16_t sum2 = s0[l] - m[l];
+			int16_t sum3 = s1[l] + m[l];
+
+			new_sums[i * CONV_BATCH_LANES + l] = sum0 > sum1 ? sum0 : sum1;
+			new_sums[(i + half) * CONV_BATCH_LANES + l] = sum2 > sum3 ? sum2 : sum3;
+			bits0 |= (sum0 > sum1) << l;
+			bits1 |= (sum2 > sum3) << l;
+		}
+
+		paths[i] = bits0;
+		paths[i + half] = bits1;
+	}
+}
+#endif
+
+/* Subtract the smallest path metric of each codeword */
+static void batch_normalize(int num_states, int16_t *sums)
+{
+	int i, l;
+	int16_t min[CONV_BATCH_LANES];
+
+	for (l = 0; l < CONV_BATCH_LANES; l++)
+		min[l] = sums[l];
+
+	for (i = 1; i < num_states; i++) {
+		for (l = 0; l < CONV_BATCH_LANES; l++) {
+			int16_t s = sums[i * CONV_BATCH_LANES + l];
+			min[l] = s < min[l] ? s : min[l];
+		}
+	}
+
+	for (i = 0; i < num_states; i++) {
+		for (l = 0; l < CONV_BATCH_LANES; l++)
+			sums[i * CONV_BATCH_LANES + l] -= min[l];
+	}
+}
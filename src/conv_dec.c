@@ -25,23 +25,33 @@
 #ifndef __APPLE__
 #include <malloc.h>
 #endif
+#include <pthread.h>
 #include <string.h>
 #include <assert.h>
 #include <errno.h>
 
 #include "defines.h"
 #include "conv.h"
-
-#include "conv_gen.h"
-#if defined(HAVE_SSE3)
-#include "conv_sse.h"
-#elif defined(HAVE_NEON)
-#include "conv_neon.h"
-#endif
+#include "conv_kernels.h"
+#include "simd.h"
 
 #define PARITY(X) __builtin_parity(X)
 #define TAIL_BITING_EXTRA 32
 
+/*
+ * Segment-parallel decoding
+ *
+ * Long tail-biting frames may be split into segments that are decoded
+ * concurrently. Each segment is preceded by SEGMENT_MARGIN warm-up steps
+ * starting from equal path metrics, and followed by SEGMENT_MARGIN steps
+ * that are only traced back through. Survivor paths merge well within
+ * the margins, so the result matches a full frame decode except at very
+ * low SNR. Frames with segments shorter than SEGMENT_MIN_LEN are decoded
+ * in one piece.
+ */
+#define SEGMENT_MARGIN 128
+#define SEGMENT_MIN_LEN 1024
+
 /*
  * Trellis State
  *
@@ -58,14 +68,20 @@ struct vstate {
  *
  * num_states - Number of states in the trellis
  * sums       - Accumulated path metrics
- * outputs    - Trellis ouput values
+ * outputs    - Trellis ouput values, either olen values per state or, for
+ *              planar_outputs kernels, one plane of num_states / 2 per output
  * vals       - Input value that led to each state
+ * u8_sums    - Accumulated 8-bit path costs (K = 7 with CONV_METRIC_8BIT)
+ * u8_outputs - Trellis output values for the 8-bit path costs, one plane
+ *              of num_states / 2 per output
  */
 struct vtrellis {
 	int num_states;
 	int16_t *sums;
 	int16_t *outputs;
 	uint8_t *vals;
+	uint8_t *u8_sums;
+	int8_t *u8_outputs;
 };
 
 /*
@@ -74,44 +90,130 @@ struct vtrellis {
  * n         - Code order
  * k         - Constraint length
  * len       - Horizontal length of trellis
+ * max_len   - Longest frame the decoder was allocated for
+ * term      - Termination type
  * recursive - Set to '1' if the code is recursive
  * intrvl    - Normalization interval
  * trellis   - Trellis object
- * punc      - Puncturing sequence
- * paths     - Trellis paths
+ * punc      - Puncturing pattern, NULL if the code is not punctured
+ * punc_len  - Length of the puncturing pattern in coded bits
+ * punc_bits - Number of transmitted bits per puncturing pattern
+ * paths     - Trellis paths (packed path decisions, one bit per state)
+ * code      - Code the decoder was allocated for
+ * num_segs  - Number of segments decoded in parallel, 0 if disabled
+ * segs      - Segment decoders and worker threads
+ * seg_*     - Worker synchronization and the frame being decoded
+ * batch     - Batched decoding state, allocated on first use
+ * kern      - Kernel set for the selected SIMD level
  */
+struct vsegment;
+struct vbatch;
+
 struct vdecoder {
 	int n;
 	int k;
 	int len;
+	int max_len;
+	int term;
 	int recursive;
 	int intrvl;
 	struct vtrellis *trellis;
-	int *punc;
-	int16_t **paths;
-
-	void (*metric_func)(const int8_t *, const int16_t *,
-			    int16_t *, int16_t *, int);
+	const int *punc;
+	int punc_len;
+	int punc_bits;
+	uint8_t **paths;
+	struct lte_conv_code code;
+
+	int num_segs;
+	struct vsegment *segs;
+	pthread_mutex_t seg_mutex;
+	pthread_cond_t seg_start_cond;
+	pthread_cond_t seg_done_cond;
+	unsigned int seg_gen;
+	int seg_pending;
+	int seg_quit;
+	const int8_t *seg_in;
+	uint8_t *seg_out;
+	int seg_len;
+
+	struct vbatch *batch;
+
+	const struct conv_kernels *kern;
 };
 
 /*
  * Aligned Memory Allocator
  *
- * SSE requires 16-byte memory alignment. We store relevant trellis values
- * (accumulated sums, outputs, and path decisions) as 16 bit signed integers
- * so the allocated memory is casted as such.
+ * SSE requires 16-byte memory alignment, AVX2 and AVX-512 require 32 and
+ * 64 bytes respectively. The kernel set is chosen at run time, so always
+ * align for AVX-512. We store relevant trellis values (accumulated sums
+ * and outputs) as 16 bit signed integers so the allocated memory is casted
+ * as such.
  */
-#define SSE_ALIGN	16
+#define SSE_ALIGN	64
 
 static int16_t *vdec_malloc(size_t n)
 {
-#if defined(HAVE_SSE3) && !defined(__APPLE__)
-	return (int16_t *) memalign(SSE_ALIGN, sizeof(int16_t) * n);
+#ifdef _WIN32
+	return (int16_t *) _aligned_malloc(sizeof(int16_t) * n, SSE_ALIGN);
+#else
+	void *ptr;
+
+	if (posix_memalign(&ptr, SSE_ALIGN, sizeof(int16_t) * n) != 0)
+		return NULL;
+
+	return (int16_t *) ptr;
+#endif
+}
+
+static void vdec_free(int16_t *ptr)
+{
+#ifdef _WIN32
+	_aligned_free(ptr);
 #else
-	return (int16_t *) malloc(sizeof(int16_t) * n);
+	free(ptr);
 #endif
 }
 
+/* Kernel set for the SIMD level chosen at run time */
+static const struct conv_kernels *vdec_kernels(void)
+{
+	switch (simd_level()) {
+#ifdef USE_SSE
+	case SIMD_SSE3:
+		return &conv_kernels_sse3;
+	case SIMD_SSE41:
+		return &conv_kernels_sse41;
+#endif
+#ifdef USE_AVX2
+	case SIMD_AVX2:
+		return &conv_kernels_avx2;
+#endif
+#ifdef USE_AVX512
+	case SIMD_AVX512:
+		return &conv_kernels_avx512;
+#endif
+#ifdef USE_NEON
+	case SIMD_NEON:
+		return &conv_kernels_neon;
+#endif
+	default:
+		return &conv_kernels_gen;
+	}
+}
+
+/*
+ * Path decision lookup
+ *
+ * Decisions are packed one bit per state, with the bit set where the path
+ * from the even predecessor state was selected. Return the path value used
+ * to find the previous state.
+ */
+static inline unsigned vdec_path(const uint8_t *paths, unsigned state)
+{
+	return ((paths[state >> 3] >> (state & 7)) & 1) ^ 1;
+}
+
 /* Left shift and mask for finding the previous state */
 static unsigned vstate_lshift(unsigned reg, int k, int val)
 {
@@ -198,9 +300,11 @@ static void free_trellis(struct vtrellis *trellis)
 	if (!trellis)
 		return;
 
+	free(trellis->u8_outputs);
+	free(trellis->u8_sums);
 	free(trellis->vals);
-	free(trellis->outputs);
-	free(trellis->sums);
+	vdec_free(trellis->outputs);
+	vdec_free(trellis->sums);
 	free(trellis);
 }
 
@@ -214,11 +318,12 @@ static void free_trellis(struct vtrellis *trellis)
  * is used by the butterfly operation in the forward recursion, so only one
  * set of N outputs is required per state variable.
  */
-static struct vtrellis *generate_trellis(const struct lte_conv_code *code)
+static struct vtrellis *generate_trellis(const struct lte_conv_code *code,
+					 const struct conv_kernels *kern)
 {
-	int i;
+	int i, j;
 	struct vtrellis *trellis;
-	int16_t *out;
+	int16_t out[4] = { 0 };
 
 	int ns = NUM_STATES(code->k);
 	int olen = (code->n == 2) ? 2 : 4;
@@ -232,14 +337,37 @@ static struct vtrellis *generate_trellis(const struct lte_conv_code *code)
 	if (!trellis->sums || !trellis->outputs)
 		goto fail;
 
+#ifdef CONV_METRIC_8BIT
+	if (code->k == 7) {
+		trellis->u8_sums = (uint8_t *) malloc(ns);
+		trellis->u8_outputs = (int8_t *) malloc(code->n * ns / 2);
+		if (!trellis->u8_sums || !trellis->u8_outputs)
+			goto fail;
+	}
+#endif
+
 	/* Populate the trellis state objects */
 	for (i = 0; i < ns; i++) {
-		out = &trellis->outputs[olen * i];
-
 		if (code->rgen)
 			gen_rec_state_info(code, &trellis->vals[i], i, out);
 		else
 			gen_state_info(code, &trellis->vals[i], i, out);
+
+		if (kern->planar_outputs) {
+			/* Only the first half of the states is read by the butterflies */
+			if (i < ns / 2) {
+				for (j = 0; j < code->n; j++)
+					trellis->outputs[j * ns / 2 + i] = out[j];
+			}
+		} else {
+			for (j = 0; j < olen; j++)
+				trellis->outputs[olen * i + j] = out[j];
+		}
+
+		if (trellis->u8_outputs && i < ns / 2) {
+			for (j = 0; j < code->n; j++)
+				trellis->u8_outputs[j * ns / 2 + i] = out[j];
+		}
 	}
 
 	return trellis;
@@ -264,6 +392,18 @@ static void reset_decoder(struct vdecoder *dec, int term)
 
 	if (term != CONV_TERM_TAIL_BITING)
 		dec->trellis->sums[0] = INT8_MAX * dec->n * dec->k;
+
+#ifdef CONV_METRIC_8BIT
+	/* Path costs start with the zero state at the lowest cost */
+	if (dec->trellis->u8_sums) {
+		if (term != CONV_TERM_TAIL_BITING) {
+			memset(dec->trellis->u8_sums, U8_MAX_BRANCH * dec->k, ns);
+			dec->trellis->u8_sums[0] = 0;
+		} else {
+			memset(dec->trellis->u8_sums, 0, ns);
+		}
+	}
+#endif
 }
 
 static int _traceback(struct vdecoder *dec,
@@ -273,7 +413,7 @@ static int _traceback(struct vdecoder *dec,
 	unsigned path;
 
 	for (i = len - 1; i >= 0; i--) {
-		path = dec->paths[i + offset][state] + 1;
+		path = vdec_path(dec->paths[i + offset], state);
 		out[i] = dec->trellis->vals[state];
 		state = vstate_lshift(state, dec->k, path);
 	}
@@ -288,7 +428,7 @@ static void _traceback_rec(struct vdecoder *dec,
 	unsigned path;
 
 	for (i = len - 1; i >= 0; i--) {
-		path = dec->paths[i][state] + 1;
+		path = vdec_path(dec->paths[i], state);
 		out[i] = path ^ dec->trellis->vals[state];
 		state = vstate_lshift(state, dec->k, path);
 	}
@@ -299,9 +439,10 @@ static void _traceback_rec(struct vdecoder *dec,
  *
  * For tail biting, find the largest accumulated path metric at the final state
  * followed by two trace back passes. For zero flushing the final state is
- * always zero with a single traceback path.
+ * always zero with a single traceback path. The 'offset' trellis steps
+ * before the output bits are not decoded.
  */
-static int traceback(struct vdecoder *dec, uint8_t *out, int term, int len)
+static int traceback(struct vdecoder *dec, uint8_t *out, int term, int len, int offset)
 {
 	int i, sum, max_p = -1, max = -1;
 	unsigned path, state = 0;
@@ -317,13 +458,13 @@ static int traceback(struct vdecoder *dec, uint8_t *out, int term, int len)
 		}
 		if (max < 0)
 			return -EPROTO;
-		for (i = dec->len - 1; i >= len + TAIL_BITING_EXTRA; i--) {
-			path = dec->paths[i][state] + 1;
+		for (i = dec->len - 1; i >= len + offset; i--) {
+			path = vdec_path(dec->paths[i], state);
 			state = vstate_lshift(state, dec->k, path);
 		}
 	} else {
 		for (i = dec->len - 1; i >= len; i--) {
-			path = dec->paths[i][state] + 1;
+			path = vdec_path(dec->paths[i], state);
 			state = vstate_lshift(state, dec->k, path);
 		}
 	}
@@ -331,19 +472,33 @@ static int traceback(struct vdecoder *dec, uint8_t *out, int term, int len)
 	if (dec->recursive)
 		_traceback_rec(dec, state, out, len);
 	else
-		state =_traceback(dec, state, out, len, term == CONV_TERM_TAIL_BITING ? TAIL_BITING_EXTRA : 0);
+		state =_traceback(dec, state, out, len, offset);
 
 	/* Don't handle the odd case of recursize tail-biting codes */
 
 	return max - max_p;
 }
 
+/* Set the trellis length for a frame of 'len' bits */
+static void set_len(struct vdecoder *dec, int len)
+{
+	if (dec->term == CONV_TERM_FLUSH)
+		dec->len = len + dec->k - 1;
+	else
+		dec->len = len + TAIL_BITING_EXTRA * 2;
+}
+
+static void stop_segments(struct vdecoder *dec);
+static void free_batch(struct vbatch *batch);
+
 /* Release decoder object */
 static void free_vdec(struct vdecoder *dec)
 {
 	if (!dec)
 		return;
 
+	stop_segments(dec);
+	free_batch(dec->batch);
 	free(dec->paths[0]);
 	free(dec->paths);
 	free_trellis(dec->trellis);
@@ -354,7 +509,9 @@ static void free_vdec(struct vdecoder *dec)
  * Allocate decoder object
  *
  * Subtract the constraint length K on the normalization interval to
- * accommodate the initialization path metric at state zero.
+ * accommodate the initialization path metric at state zero. Path memory
+ * is sized for frames of up to code->len bits so that the decoder can be
+ * reused for every frame of the code.
  */
 static struct vdecoder *alloc_vdec(const struct lte_conv_code *code)
 {
@@ -366,25 +523,37 @@ static struct vdecoder *alloc_vdec(const struct lte_conv_code *code)
 	dec = (struct vdecoder *) calloc(1, sizeof(struct vdecoder));
 	dec->n = code->n;
 	dec->k = code->k;
+	dec->max_len = code->len;
+	dec->term = code->term;
+	dec->code = *code;
+	dec->kern = vdec_kernels();
 	dec->recursive = code->rgen ? 1 : 0;
 	dec->intrvl = INT16_MAX / (dec->n * INT8_MAX) - dec->k;
+	if (code->punc) {
+		dec->punc = code->punc;
+		for (i = 0; code->punc[i] >= 0; i++)
+			dec->punc_bits += code->punc[i];
+		dec->punc_len = i;
+	}
+#ifdef CONV_METRIC_8BIT
+	if (dec->k == 7)
+		dec->intrvl = U8_INTERVAL(dec->k);
+#endif
 
     assert(dec->n == 3);
     assert(dec->k == 7 || dec->k == 9);
+    assert(dec->punc_len % dec->n == 0);
 
-	if (code->term == CONV_TERM_FLUSH)
-		dec->len = code->len + code->k - 1;
-	else
-		dec->len = code->len + TAIL_BITING_EXTRA * 2;
+	set_len(dec, code->len);
 
-	dec->trellis = generate_trellis(code);
+	dec->trellis = generate_trellis(code, dec->kern);
 	if (!dec->trellis)
 		goto fail;
 
-	dec->paths = (int16_t **) malloc(sizeof(int16_t *) * dec->len);
-	dec->paths[0] = vdec_malloc(ns * dec->len);
+	dec->paths = (uint8_t **) malloc(sizeof(uint8_t *) * dec->len);
+	dec->paths[0] = (uint8_t *) malloc(ns / 8 * dec->len);
 	for (i = 1; i < dec->len; i++)
-		dec->paths[i] = &dec->paths[0][i * ns];
+		dec->paths[i] = &dec->paths[0][i * ns / 8];
 
 	return dec;
 fail:
@@ -392,87 +561,556 @@ fail:
 	return NULL;
 }
 
+/*
+ * Punctured input offset
+ *
+ * Return the index of the first soft bit of trellis step 'j' in the
+ * punctured input sequence.
+ */
+static int punc_offset(const struct vdecoder *dec, int j)
+{
+	int i, pos = j * dec->n;
+	int offset = pos / dec->punc_len * dec->punc_bits;
+
+	for (i = 0; i < pos % dec->punc_len; i++)
+		offset += dec->punc[i];
+
+	return offset;
+}
+
 /*
  * Forward trellis recursion
  *
  * Generate branch metrics and path metrics with a combined function. Only
  * accumulated path metric sums and path selections are stored. Normalize on
- * the interval specified by the decoder.
+ * the interval specified by the decoder. The recursion starts at input
+ * 'start' and wraps around the frame for tail-biting codes.
+ *
+ * Punctured input is read directly. The soft bits of each step are gathered
+ * with zeros in the punctured positions, which drops those terms from the
+ * branch metrics.
  */
-static void _conv_decode(struct vdecoder *dec, const int8_t *seq, int term, int len)
+static void _conv_decode(struct vdecoder *dec, const int8_t *seq, int term, int len, int start)
 {
-	int i, j = 0;
+	int i, j = start, norm, step = 0;
+	int q, pos = 0, offset = 0;
+	int8_t punc_seq[4];
+	const int8_t *in;
 	struct vtrellis *trellis = dec->trellis;
 
-	if (term == CONV_TERM_TAIL_BITING)
-		j = len - TAIL_BITING_EXTRA;
+	if (dec->punc) {
+		offset = punc_offset(dec, start);
+		pos = start * dec->n % dec->punc_len;
+	}
 
 	for (i = 0; i < dec->len; i++, j++) {
-		if (term == CONV_TERM_TAIL_BITING && j == len)
+		if (term == CONV_TERM_TAIL_BITING && j == len) {
 			j = 0;
+			pos = 0;
+			offset = 0;
+		}
+
+		if (dec->punc) {
+			for (q = 0; q < dec->n; q++)
+				punc_seq[q] = dec->punc[pos + q] ? seq[offset++] : 0;
+			pos += dec->n;
+			if (pos == dec->punc_len)
+				pos = 0;
+			in = punc_seq;
+		} else {
+			in = &seq[dec->n * j];
+		}
+
+		/* Same as !(i % dec->intrvl), without a division per step */
+		norm = (step == 0);
+		if (++step == dec->intrvl)
+			step = 0;
 
 		if (dec->k == 7)
-			gen_metrics_k7_n3(&seq[dec->n * j],
+#ifdef CONV_METRIC_8BIT
+			dec->kern->metrics_k7_n3_u8(in,
+					 trellis->u8_outputs,
+					 trellis->u8_sums,
+					 dec->paths[i],
+					 norm);
+#else
+			dec->kern->metrics_k7_n3(in,
 					 trellis->outputs,
 					 trellis->sums,
 					 dec->paths[i],
-					 !(i % dec->intrvl));
+					 norm);
+#endif
 		else if (dec->k == 9)
-			gen_metrics_k9_n3(&seq[dec->n * j],
+			dec->kern->metrics_k9_n3(in,
 					 trellis->outputs,
 					 trellis->sums,
 					 dec->paths[i],
-					 !(i % dec->intrvl));
+					 norm);
+	}
+
+#ifdef CONV_METRIC_8BIT
+	/* Convert path costs to path metrics for the traceback */
+	if (trellis->u8_sums) {
+		for (i = 0; i < trellis->num_states; i++)
+			trellis->sums[i] = UINT8_MAX - trellis->u8_sums[i];
+	}
+#endif
+}
+
+/*
+ * Segment decoder
+ *
+ * Each segment owns a decoder sized for one segment plus margins. Segment
+ * zero is decoded by the calling thread and the others by worker threads.
+ */
+struct vsegment {
+	struct vdecoder *parent;
+	struct vdecoder *dec;
+	int index;
+	int started;
+	int ret;
+	pthread_t thread;
+};
+
+/* Decode one segment of the frame set on the parent decoder */
+static void decode_segment(struct vsegment *seg)
+{
+	struct vdecoder *parent = seg->parent;
+	struct vdecoder *dec = seg->dec;
+	int len = parent->seg_len;
+	int start = (long) len * seg->index / parent->num_segs;
+	int end = (long) len * (seg->index + 1) / parent->num_segs;
+
+	dec->len = end - start + 2 * SEGMENT_MARGIN;
+	reset_decoder(dec, CONV_TERM_TAIL_BITING);
+
+	_conv_decode(dec, parent->seg_in, CONV_TERM_TAIL_BITING, len,
+		     (start - SEGMENT_MARGIN + len) % len);
+	seg->ret = traceback(dec, parent->seg_out + start, CONV_TERM_TAIL_BITING,
+			     end - start, SEGMENT_MARGIN);
+}
+
+static void *segment_worker(void *arg)
+{
+	struct vsegment *seg = arg;
+	struct vdecoder *parent = seg->parent;
+	unsigned int gen = 0;
+
+	pthread_mutex_lock(&parent->seg_mutex);
+	while (1) {
+		while (!parent->seg_quit && parent->seg_gen == gen)
+			pthread_cond_wait(&parent->seg_start_cond, &parent->seg_mutex);
+		if (parent->seg_quit)
+			break;
+		gen = parent->seg_gen;
+		pthread_mutex_unlock(&parent->seg_mutex);
+
+		decode_segment(seg);
+
+		pthread_mutex_lock(&parent->seg_mutex);
+		if (--parent->seg_pending == 0)
+			pthread_cond_signal(&parent->seg_done_cond);
 	}
+	pthread_mutex_unlock(&parent->seg_mutex);
+
+	return NULL;
 }
 
-static int nrsc5_conv_decode(const int8_t *in, uint8_t *out, int k, int len, unsigned int g1, unsigned int g2, unsigned int g3)
+/* Stop the worker threads and release the segment decoders */
+static void stop_segments(struct vdecoder *dec)
+{
+	int i;
+
+	if (!dec->segs)
+		return;
+
+	pthread_mutex_lock(&dec->seg_mutex);
+	dec->seg_quit = 1;
+	pthread_cond_broadcast(&dec->seg_start_cond);
+	pthread_mutex_unlock(&dec->seg_mutex);
+
+	for (i = 0; i < dec->num_segs; i++) {
+		if (dec->segs[i].started)
+			pthread_join(dec->segs[i].thread, NULL);
+		free_vdec(dec->segs[i].dec);
+	}
+
+	pthread_cond_destroy(&dec->seg_done_cond);
+	pthread_cond_destroy(&dec->seg_start_cond);
+	pthread_mutex_destroy(&dec->seg_mutex);
+	free(dec->segs);
+	dec->segs = NULL;
+	dec->num_segs = 0;
+}
+
+/* Start worker threads for decoding frames in 'num' segments */
+static int start_segments(struct vdecoder *dec, int num)
+{
+	int i;
+	struct lte_conv_code code = dec->code;
+
+	code.len = (dec->max_len + num - 1) / num + 2 * SEGMENT_MARGIN;
+
+	dec->segs = (struct vsegment *) calloc(num, sizeof(struct vsegment));
+	if (!dec->segs)
+		return -ENOMEM;
+
+	dec->num_segs = num;
+	dec->seg_gen = 0;
+	dec->seg_quit = 0;
+	pthread_mutex_init(&dec->seg_mutex, NULL);
+	pthread_cond_init(&dec->seg_start_cond, NULL);
+	pthread_cond_init(&dec->seg_done_cond, NULL);
+
+	for (i = 0; i < num; i++) {
+		dec->segs[i].parent = dec;
+		dec->segs[i].index = i;
+		dec->segs[i].dec = alloc_vdec(&code);
+		if (!dec->segs[i].dec)
+			goto fail;
+	}
+
+	for (i = 1; i < num; i++) {
+		if (pthread_create(&dec->segs[i].thread, NULL, segment_worker, &dec->segs[i]) != 0)
+			goto fail;
+		dec->segs[i].started = 1;
+	}
+
+	return 0;
+fail:
+	stop_segments(dec);
+	return -ENOMEM;
+}
+
+/*
+ * Decode a tail-biting frame with all segments in parallel
+ *
+ * Returns the first segment error, or else the traceback result of segment
+ * zero, as the single piece decoder would.
+ */
+static int decode_segments(struct vdecoder *dec, const int8_t *in, uint8_t *out, int len)
+{
+	int i;
+
+	pthread_mutex_lock(&dec->seg_mutex);
+	dec->seg_in = in;
+	dec->seg_out = out;
+	dec->seg_len = len;
+	dec->seg_pending = dec->num_segs - 1;
+	dec->seg_gen++;
+	pthread_cond_broadcast(&dec->seg_start_cond);
+	pthread_mutex_unlock(&dec->seg_mutex);
+
+	decode_segment(&dec->segs[0]);
+
+	pthread_mutex_lock(&dec->seg_mutex);
+	while (dec->seg_pending > 0)
+		pthread_cond_wait(&dec->seg_done_cond, &dec->seg_mutex);
+	pthread_mutex_unlock(&dec->seg_mutex);
+
+	for (i = 0; i < dec->num_segs; i++) {
+		if (dec->segs[i].ret < 0)
+			return dec->segs[i].ret;
+	}
+
+	return dec->segs[0].ret;
+}
+
+/* Puncturing patterns, named by code rate */
+static const int punc_2_5[] = { 1, 1, 1, 1, 1, 0, -1 };
+static const int punc_1_2[] = { 1, 0, 1, 1, 0, 1, -1 };
+static const int punc_5_12[] = { 1, 0, 1, 1, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, -1 };
+static const int punc_2_3[] = { 1, 0, 1, 1, 0, 0, -1 };
+
+/*
+ * Batched decoder
+ *
+ * Short tail-biting codewords of the same code are decoded side by side,
+ * one codeword per lane, following the same steps as the single codeword
+ * decoder.
+ *
+ * outputs - Branch metric index of each butterfly
+ * seq     - Soft input values of the current step
+ * metrics - Branch metrics of the current step
+ * sums    - Accumulated path metrics
+ * paths   - Path decisions of every step
+ */
+struct vbatch {
+	uint8_t *outputs;
+	int16_t *seq;
+	int16_t *metrics;
+	int16_t *sums;
+	int16_t *new_sums;
+	uint16_t *paths;
+};
+
+static void free_batch(struct vbatch *batch)
+{
+	if (!batch)
+		return;
+
+	free(batch->outputs);
+	free(batch->seq);
+	free(batch->metrics);
+	free(batch->sums);
+	free(batch->new_sums);
+	free(batch->paths);
+	free(batch);
+}
+
+static struct vbatch *alloc_batch(const struct vdecoder *dec)
+{
+	int i, j, ns = dec->trellis->num_states;
+	int steps = dec->max_len + TAIL_BITING_EXTRA * 2;
+	int16_t out[4] = { 0 };
+	uint8_t val;
+	struct vbatch *batch;
+
+	batch = (struct vbatch *) calloc(1, sizeof(struct vbatch));
+	if (!batch)
+		return NULL;
+
+	batch->outputs = (uint8_t *) malloc(ns / 2);
+	batch->seq = (int16_t *) malloc(sizeof(int16_t) * dec->n * CONV_BATCH_LANES);
+	batch->metrics = (int16_t *) malloc(sizeof(int16_t) * 8 * CONV_BATCH_LANES);
+	batch->sums = (int16_t *) malloc(sizeof(int16_t) * ns * CONV_BATCH_LANES);
+	batch->new_sums = (int16_t *) malloc(sizeof(int16_t) * ns * CONV_BATCH_LANES);
+	batch->paths = (uint16_t *) malloc(sizeof(uint16_t) * steps * ns);
+
+	if (!batch->outputs || !batch->seq || !batch->metrics || !batch->sums ||
+	    !batch->new_sums || !batch->paths) {
+		free_batch(batch);
+		return NULL;
+	}
+
+	for (i = 0; i < ns / 2; i++) {
+		gen_state_info(&dec->code, &val, i, out);
+		batch->outputs[i] = 0;
+		for (j = 0; j < dec->n; j++)
+			batch->outputs[i] |= (out[j] > 0) << j;
+	}
+
+	return batch;
+}
+
+/* Decode up to CONV_BATCH_LANES codewords of 'len' bits */
+static void decode_batch(struct vdecoder *dec, const int8_t *in, int in_len,
+			 uint8_t *out, int count, int len)
+{
+	struct vbatch *batch = dec->batch;
+	int ns = dec->trellis->num_states;
+	int i, j, l, q, step = 0, pos = 0, offset = 0;
+	int start = len - TAIL_BITING_EXTRA;
+	int intrvl = INT16_MAX / (dec->n * INT8_MAX) - dec->k;
+	int16_t *tmp;
+
+	dec->len = len + TAIL_BITING_EXTRA * 2;
+	memset(batch->sums, 0, sizeof(int16_t) * ns * CONV_BATCH_LANES);
+	memset(batch->seq, 0, sizeof(int16_t) * dec->n * CONV_BATCH_LANES);
+
+	if (dec->punc) {
+		offset = punc_offset(dec, start);
+		pos = start * dec->n % dec->punc_len;
+	}
+
+	/* Forward recursion, as in _conv_decode() */
+	for (i = 0, j = start; i < dec->len; i++, j++) {
+		if (j == len) {
+			j = 0;
+			pos = 0;
+			offset = 0;
+		}
+
+		for (q = 0; q < dec->n; q++) {
+			int idx = -1;
+
+			if (!dec->punc)
+				idx = dec->n * j + q;
+			else if (dec->punc[pos + q])
+				idx = offset++;
+
+			for (l = 0; l < count; l++)
+				batch->seq[q * CONV_BATCH_LANES + l] = idx < 0 ? 0 : in[l * in_len + idx];
+		}
+		if (dec->punc) {
+			pos += dec->n;
+			if (pos == dec->punc_len)
+				pos = 0;
+		}
+
+		if (step == 0)
+			dec->kern->batch_normalize(ns, batch->sums);
+		if (++step == intrvl)
+			step = 0;
+
+		dec->kern->batch_branch_metrics_n3(batch->seq, batch->metrics);
+		dec->kern->batch_path_metrics(ns, batch->metrics, batch->outputs,
+					      batch->sums, batch->new_sums,
+					      &batch->paths[i * ns]);
+
+		tmp = batch->sums;
+		batch->sums = batch->new_sums;
+		batch->new_sums = tmp;
+	}
+
+	/* Traceback, as in traceback() */
+	for (l = 0; l < count; l++) {
+		unsigned state = 0;
+		int max = INT16_MIN;
+
+		for (i = 0; i < ns; i++) {
+			if (batch->sums[i * CONV_BATCH_LANES + l] > max) {
+				max = batch->sums[i * CONV_BATCH_LANES + l];
+				state = i;
+			}
+		}
+
+		for (i = dec->len - 1; i >= TAIL_BITING_EXTRA; i--) {
+			unsigned path = ((batch->paths[i * ns + state] >> l) & 1) ^ 1;
+
+			if (i < len + TAIL_BITING_EXTRA)
+				out[l * len + i - TAIL_BITING_EXTRA] = dec->trellis->vals[state];
+			state = vstate_lshift(state, dec->k, path);
+		}
+	}
+}
+
+/*
+ * Decode 'count' tail-biting codewords of 'len' bits each
+ *
+ * The input holds the punctured codewords back to back, and the output
+ * receives the decoded codewords back to back. Codewords are decoded
+ * CONV_BATCH_LANES at a time.
+ */
+int nrsc5_conv_decode_batch(struct vdecoder *dec, const int8_t *in, uint8_t *out, int count, int len)
+{
+	int in_len = len * dec->n;
+
+	if (len > dec->max_len || dec->term != CONV_TERM_TAIL_BITING)
+		return -EINVAL;
+	if (dec->punc) {
+		if (in_len % dec->punc_len)
+			return -EINVAL;
+		in_len = in_len / dec->punc_len * dec->punc_bits;
+	}
+
+	if (!dec->batch) {
+		dec->batch = alloc_batch(dec);
+		if (!dec->batch)
+			return -ENOMEM;
+	}
+
+	while (count > 0) {
+		int num = count < CONV_BATCH_LANES ? count : CONV_BATCH_LANES;
+
+		decode_batch(dec, in, in_len, out, num, len);
+		in += num * in_len;
+		out += num * len;
+		count -= num;
+	}
+
+	return 0;
+}
+
+static struct vdecoder *nrsc5_conv_alloc(int k, int len, unsigned int g1, unsigned int g2, unsigned int g3,
+					 const int *punc)
 {
 	const struct lte_conv_code code = {
 		.n = 3,
 		.k = k,
 		.len = len,
 		.gen = { g1, g2, g3 },
+		.punc = punc,
 		.term = CONV_TERM_TAIL_BITING,
 	};
-	int rc;
 
-	struct vdecoder *vdec = alloc_vdec(&code);
-	if (!vdec)
-		return -EFAULT;
+	return alloc_vdec(&code);
+}
 
-	reset_decoder(vdec, code.term);
+struct vdecoder *nrsc5_conv_alloc_p1(void)
+{
+	return nrsc5_conv_alloc(7, P1_FRAME_LEN_FM, 0133, 0171, 0165, punc_2_5);
+}
 
-	/* Propagate through the trellis with interval normalization */
-	_conv_decode(vdec, in, code.term, code.len);
+struct vdecoder *nrsc5_conv_alloc_pids(void)
+{
+	return nrsc5_conv_alloc(7, PIDS_FRAME_LEN, 0133, 0171, 0165, punc_2_5);
+}
 
-	rc = traceback(vdec, out, code.term, code.len);
+struct vdecoder *nrsc5_conv_alloc_p3_p4(void)
+{
+	return nrsc5_conv_alloc(7, P3_FRAME_LEN_MP3_MP11, 0133, 0171, 0165, punc_1_2);
+}
 
-	free_vdec(vdec);
-	return rc;
+struct vdecoder *nrsc5_conv_alloc_e1(void)
+{
+	return nrsc5_conv_alloc(9, P3_FRAME_LEN_MA3, 0561, 0657, 0711, punc_5_12);
 }
 
-int nrsc5_conv_decode_p1(const int8_t *in, uint8_t *out)
+struct vdecoder *nrsc5_conv_alloc_e2(void)
 {
-	return nrsc5_conv_decode(in, out, 7, P1_FRAME_LEN_FM, 0133, 0171, 0165);
+	return nrsc5_conv_alloc(9, P3_FRAME_LEN_MA1, 0561, 0753, 0711, punc_2_3);
 }
 
-int nrsc5_conv_decode_pids(const int8_t *in, uint8_t *out)
+struct vdecoder *nrsc5_conv_alloc_e3(void)
 {
-	return nrsc5_conv_decode(in, out, 7, PIDS_FRAME_LEN, 0133, 0171, 0165);
+	return nrsc5_conv_alloc(9, PIDS_FRAME_LEN, 0561, 0753, 0711, NULL);
 }
 
-int nrsc5_conv_decode_p3_p4(const int8_t *in, uint8_t *out, int len)
+void nrsc5_conv_free(struct vdecoder *dec)
 {
-	return nrsc5_conv_decode(in, out, 7, len, 0133, 0171, 0165);
+	free_vdec(dec);
 }
 
-int nrsc5_conv_decode_e1(const int8_t *in, uint8_t *out, int len)
+/*
+ * Set the number of threads used to decode a frame
+ *
+ * With more than one thread, tail-biting frames are split into as many
+ * segments, which are decoded concurrently. One thread decodes frames in
+ * one piece on the calling thread.
+ */
+int nrsc5_conv_set_threads(struct vdecoder *dec, int threads)
 {
-  return nrsc5_conv_decode(in, out, 9, len, 0561, 0657, 0711);
+	if (threads < 1)
+		return -EINVAL;
+
+	stop_segments(dec);
+
+	if (threads == 1 || dec->term != CONV_TERM_TAIL_BITING)
+		return 0;
+
+	return start_segments(dec, threads);
 }
 
-int nrsc5_conv_decode_e2_e3(const int8_t *in, uint8_t *out, int len)
+/*
+ * Decode a frame of 'len' bits
+ *
+ * The decoder is reset before every frame, so a single decoder object can be
+ * reused for any frame length up to the one it was allocated for. Input is
+ * the punctured sequence of soft bits, and its length must be a whole
+ * number of puncturing patterns.
+ */
+int nrsc5_conv_decode(struct vdecoder *dec, const int8_t *in, uint8_t *out, int len)
 {
-  return nrsc5_conv_decode(in, out, 9, len, 0561, 0753, 0711);
+	int offset = 0, start = 0;
+
+	if (len > dec->max_len)
+		return -EINVAL;
+	if (dec->punc && (len * dec->n) % dec->punc_len)
+		return -EINVAL;
+	if (dec->num_segs > 1 && len >= dec->num_segs * SEGMENT_MIN_LEN)
+		return decode_segments(dec, in, out, len);
+
+	set_len(dec, len);
+	reset_decoder(dec, dec->term);
+
+	if (dec->term == CONV_TERM_TAIL_BITING) {
+		offset = TAIL_BITING_EXTRA;
+		start = len - TAIL_BITING_EXTRA;
+	}
+
+	/* Propagate through the trellis with interval normalization */
+	_conv_decode(dec, in, dec->term, len, start);
+
+	return traceback(dec, out, dec->term, len, offset);
 }
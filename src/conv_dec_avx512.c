@@ -0,0 +1,27 @@
+/*
+ * Viterbi decoder for convolutional codes - AVX-512 kernel set
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "conv_kernels.h"
+#include "conv_avx512.h"
+#include "conv_batch.h"
+#ifdef CONV_METRIC_8BIT
+#include "conv_u8.h"
+#endif
+
+const struct conv_kernels conv_kernels_avx512 = CONV_KERNELS(1);
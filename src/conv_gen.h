@@ -22,6 +22,9 @@
 #include <stdint.h>
 #include <string.h>
 
+/* The AVX2 and AVX-512 kernels replace the generic ones for all codes */
+#if !defined(HAVE_AVX2)
+
 /*
  * Add-Compare-Select (ACS-Butterfly)
  *
@@ -61,6 +64,27 @@ static void acs_butterfly(int state, int num_states,
 	}
 }
 
+/*
+ * Pack path selections
+ *
+ * Reduce path selections to one bit per state, with the lowest state in the
+ * least significant bit. This matches the output of the sse movemask
+ * instruction.
+ */
+static void _gen_pack_paths(int num_states, const int16_t *sel, uint8_t *paths)
+{
+	int i, j;
+
+	for (i = 0; i < num_states / 8; i++) {
+		uint8_t bits = 0;
+
+		for (j = 0; j < 8; j++)
+			bits |= (sel[8 * i + j] & 1) << j;
+
+		paths[i] = bits;
+	}
+}
+
 /* Branch metrics unit N=3 */
 static void _gen_branch_metrics_n3(int num_states, const int8_t *seq,
 			    const int16_t *out, int16_t *metrics)
@@ -75,17 +99,20 @@ static void _gen_branch_metrics_n3(int num_states, const int8_t *seq,
 
 /* Path metric unit */
 static void _gen_path_metrics(int num_states, int16_t *sums,
-		       int16_t *metrics, int16_t *paths, int norm)
+		       int16_t *metrics, uint8_t *paths, int norm)
 {
 	int i;
 	int16_t min;
 	int16_t new_sums[num_states];
+	int16_t sel[num_states];
 
 	for (i = 0; i < num_states / 2; i++) {
 		acs_butterfly(i, num_states, metrics[i],
-			      sums, &new_sums[i], &paths[i]);
+			      sums, &new_sums[i], &sel[i]);
 	}
 
+	_gen_pack_paths(num_states, sel, paths);
+
 	if (norm) {
 		min = new_sums[0];
 		for (i = 1; i < num_states; i++) {
@@ -100,9 +127,9 @@ static void _gen_path_metrics(int num_states, int16_t *sums,
 	memcpy(sums, new_sums, num_states * sizeof(int16_t));
 }
 
-#if !defined(HAVE_SSE3) && !defined(HAVE_NEON)
+#if !defined(HAVE_SSE3) && !defined(HAVE_NEON) && !defined(CONV_METRIC_8BIT)
 static void gen_metrics_k7_n3(const int8_t *seq, const int16_t *out,
-		       int16_t *sums, int16_t *paths, int norm)
+		       int16_t *sums, uint8_t *paths, int norm)
 {
 	int16_t metrics[32];
 
@@ -113,7 +140,7 @@ static void gen_metrics_k7_n3(const int8_t *seq, const int16_t *out,
 #endif
 
 static void gen_metrics_k9_n3(const int8_t *seq, const int16_t *out,
-		       int16_t *sums, int16_t *paths, int norm)
+		       int16_t *sums, uint8_t *paths, int norm)
 {
 	int16_t metrics[128];
 
@@ -121,3 +148,4 @@ static void gen_metrics_k9_n3(const int8_t *seq, const int16_t *out,
 	_gen_path_metrics(256, sums, metrics, paths, norm);
 
 }
+#endif
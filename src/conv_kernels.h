@@ -0,0 +1,108 @@
+/*
+ * Viterbi decoder for convolutional codes - kernel sets
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CONV_KERNELS_H_
+#define _CONV_KERNELS_H_
+
+#include <stdint.h>
+
+/*
+ * 8-bit path metrics (K = 7, N = 3)
+ *
+ * Path metrics are kept as unsigned 8-bit costs, where lower is better, so
+ * that twice as many states fit in a vector register as with the 16-bit
+ * metrics. Soft inputs are scaled down by U8_SOFT_SHIFT bits, and the cost
+ * of a branch is the sum of the scaled soft bit magnitudes that disagree
+ * with the branch output. With N = 3 a branch costs at most U8_MAX_BRANCH.
+ * For the branch metric 'm' of the 16-bit decoder and the sum 'M' of the
+ * scaled magnitudes, the two branches leaving a state cost a = (M - m) / 2
+ * and M - a.
+ *
+ * Any state is reachable from the best state in K - 1 steps, so costs are
+ * spread over at most (K - 1) * U8_MAX_BRANCH. The normalization interval
+ * is chosen so that the best path never saturates, and only paths that
+ * cannot survive are clamped at UINT8_MAX.
+ *
+ * Trellis outputs are given as N planes of 32 8-bit values.
+ */
+#define U8_SOFT_SHIFT	4
+#define U8_MAX_BRANCH	(3 * (INT8_MAX >> U8_SOFT_SHIFT))
+#define U8_INTERVAL(K)	((UINT8_MAX - ((K) - 1) * U8_MAX_BRANCH) / U8_MAX_BRANCH)
+
+/*
+ * Number of codewords decoded together
+ *
+ * Path metrics hold one row of CONV_BATCH_LANES values per state, one value
+ * per codeword. Path decisions hold one 16-bit word per state, with bit l
+ * set where the even state path was selected for codeword l.
+ */
+#define CONV_BATCH_LANES	16
+
+/*
+ * Kernel set
+ *
+ * Each instruction set level is built in its own file, conv_dec_*.c, with
+ * the compiler flags of that level, and fills in one of these.
+ *
+ * planar_outputs     - Trellis outputs are read as N planes of
+ *                      num_states / 2 values instead of 4 values per state
+ * metrics_k7_n3      - Combined BMU/PMU, K = 7, 16-bit path metrics
+ * metrics_k7_n3_u8   - Combined BMU/PMU, K = 7, 8-bit path costs (only
+ *                      with CONV_METRIC_8BIT, which replaces the above)
+ * metrics_k9_n3      - Combined BMU/PMU, K = 9
+ * batch_*            - Batched decoder units from conv_batch.h
+ */
+struct conv_kernels {
+	int planar_outputs;
+	void (*metrics_k7_n3)(const int8_t *seq, const int16_t *out,
+			      int16_t *sums, uint8_t *paths, int norm);
+	void (*metrics_k7_n3_u8)(const int8_t *seq, const int8_t *out,
+				 uint8_t *sums, uint8_t *paths, int norm);
+	void (*metrics_k9_n3)(const int8_t *seq, const int16_t *out,
+			      int16_t *sums, uint8_t *paths, int norm);
+	void (*batch_branch_metrics_n3)(const int16_t *seq, int16_t *metrics);
+	void (*batch_path_metrics)(int num_states, const int16_t *metrics,
+				   const uint8_t *out, const int16_t *sums,
+				   int16_t *new_sums, uint16_t *paths);
+	void (*batch_normalize)(int num_states, int16_t *sums);
+};
+
+#ifdef CONV_METRIC_8BIT
+#define CONV_KERNELS_K7	.metrics_k7_n3_u8 = gen_metrics_k7_n3_u8
+#else
+#define CONV_KERNELS_K7	.metrics_k7_n3 = gen_metrics_k7_n3
+#endif
+
+/* Kernel set initializer for the kernels included in a conv_dec_*.c file */
+#define CONV_KERNELS(PLANAR) \
+{ \
+	.planar_outputs = PLANAR, \
+	CONV_KERNELS_K7, \
+	.metrics_k9_n3 = gen_metrics_k9_n3, \
+	.batch_branch_metrics_n3 = batch_branch_metrics_n3, \
+	.batch_path_metrics = batch_path_metrics, \
+	.batch_normalize = batch_normalize, \
+}
+
+extern const struct conv_kernels conv_kernels_gen;
+extern const struct conv_kernels conv_kernels_sse3;
+extern const struct conv_kernels conv_kernels_sse41;
+extern const struct conv_kernels conv_kernels_avx2;
+extern const struct conv_kernels conv_kernels_avx512;
+extern const struct conv_kernels conv_kernels_neon;
+
+#endif /* _CONV_KERNELS_H_ */
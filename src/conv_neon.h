@@ -78,8 +78,18 @@
     M6 = vqsubq_s16(M6, M8); \
     M7 = vqsubq_s16(M7, M8); \
 }
+#define NEON_PACK_PATHS(M0,M1,P) \
+{ \
+    const uint8x16_t _weights = { 1, 2, 4, 8, 16, 32, 64, 128, \
+                                  1, 2, 4, 8, 16, 32, 64, 128 }; \
+    uint8x16_t _sel = vcombine_u8(vmovn_u16(vreinterpretq_u16_s16(M0)), \
+                                  vmovn_u16(vreinterpretq_u16_s16(M1))); \
+    uint64x2_t _bits = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(vandq_u8(_sel, _weights)))); \
+    (P)[0] = vgetq_lane_u64(_bits, 0); \
+    (P)[1] = vgetq_lane_u64(_bits, 1); \
+}
 static inline void _neon_metrics_k7_n4(const int16_t *val, const int16_t *out,
-					int16_t *sums, int16_t *paths, int norm)
+					int16_t *sums, uint8_t *paths, int norm)
 {
     int16x8_t m0, m1, m2, m3, m4, m5, m6, m7;
     int16x8_t m8, m9, m10, m11, m12, m13, m14, m15;
@@ -136,19 +146,15 @@ static inline void _neon_metrics_k7_n4(const int16_t *val, const int16_t *out,
 	NEON_BUTTERFLY(m8, m9, m4, m0, m1)
 	NEON_BUTTERFLY(m10, m11, m5, m2, m3)
 
-    vst1q_s16(&paths[0], m0);
-    vst1q_s16(&paths[8], m2);
-    vst1q_s16(&paths[32], m9);
-    vst1q_s16(&paths[40], m11);
+    NEON_PACK_PATHS(m0, m2, &paths[0])
+    NEON_PACK_PATHS(m9, m11, &paths[4])
 
 	/* (PMU) Butterflies: 17-31 */
 	NEON_BUTTERFLY(m12, m13, m6, m0, m2)
 	NEON_BUTTERFLY(m14, m15, m7, m9, m11)
 
-    vst1q_s16(&paths[16], m0);
-    vst1q_s16(&paths[24], m9);
-    vst1q_s16(&paths[48], m13);
-    vst1q_s16(&paths[56], m15);
+    NEON_PACK_PATHS(m0, m9, &paths[2])
+    NEON_PACK_PATHS(m13, m15, &paths[6])
 
 	if (norm)
 		NEON_NORMALIZE_K7(m4, m1, m5, m3, m6, m2,
@@ -165,7 +171,7 @@ static inline void _neon_metrics_k7_n4(const int16_t *val, const int16_t *out,
 }
 
 static inline void gen_metrics_k7_n3(const int8_t *val, const int16_t *out,
-		       int16_t *sums, int16_t *paths, int norm)
+		       int16_t *sums, uint8_t *paths, int norm)
 {
 	const int16_t _val[4] = { val[0], val[1], val[2], 0 };
 
@@ -22,6 +22,7 @@
 #include "config.h"
 
 #include <stdint.h>
+#include <string.h>
 #include <emmintrin.h>
 #include <tmmintrin.h>
 
@@ -64,6 +65,26 @@
 	M1 = _mm_cmpgt_epi16(M0, M1); \
 }
 
+/*
+ * Pack path decisions
+ *
+ * Reduce two registers of 16-bit path selections (-1 or 0) to 16 path
+ * decision bits, one per state, and store them to the path buffer. The
+ * lowest state is placed in the least significant bit.
+ *
+ * Input:
+ * M0 - Path selections for 8 states (packed 16-bit integers)
+ * M1 - Path selections for the next 8 states (packed 16-bit integers)
+ *
+ * Output:
+ * P  - 16 path decision bits (2 bytes)
+ */
+#define SSE_PACK_PATHS(M0,M1,P) \
+{ \
+	uint16_t _bits = _mm_movemask_epi8(_mm_packs_epi16(M0, M1)); \
+	memcpy(P, &_bits, sizeof(_bits)); \
+}
+
 #define _I8_SHUFFLE_MASK 15, 14, 11, 10, 7, 6, 3, 2, 13, 12, 9, 8, 5, 4, 1, 0
 
 /*
@@ -231,7 +252,7 @@
  * metrics before computing branch metrics as in the half rate case.
  */
 static inline void _sse_metrics_k7_n4(const int16_t *val, const int16_t *out,
-					int16_t *sums, int16_t *paths, int norm)
+					int16_t *sums, uint8_t *paths, int norm)
 {
 	__m128i m0, m1, m2, m3, m4, m5, m6, m7;
 	__m128i m8, m9, m10, m11, m12, m13, m14, m15;
@@ -286,19 +307,15 @@ static inline void _sse_metrics_k7_n4(const int16_t *val, const int16_t *out,
 	SSE_BUTTERFLY(m8, m9, m4, m0, m1)
 	SSE_BUTTERFLY(m10, m11, m5, m2, m3)
 
-	_mm_store_si128((__m128i *) &paths[0], m0);
-	_mm_store_si128((__m128i *) &paths[8], m2);
-	_mm_store_si128((__m128i *) &paths[32], m9);
-	_mm_store_si128((__m128i *) &paths[40], m11);
+	SSE_PACK_PATHS(m0, m2, &paths[0])
+	SSE_PACK_PATHS(m9, m11, &paths[4])
 
 	/* (PMU) Butterflies: 17-31 */
 	SSE_BUTTERFLY(m12, m13, m6, m0, m2)
 	SSE_BUTTERFLY(m14, m15, m7, m9, m11)
 
-	_mm_store_si128((__m128i *) &paths[16], m0);
-	_mm_store_si128((__m128i *) &paths[24], m9);
-	_mm_store_si128((__m128i *) &paths[48], m13);
-	_mm_store_si128((__m128i *) &paths[56], m15);
+	SSE_PACK_PATHS(m0, m9, &paths[2])
+	SSE_PACK_PATHS(m13, m15, &paths[6])
 
 	if (norm)
 		SSE_NORMALIZE_K7(m4, m1, m5, m3, m6, m2,
@@ -314,10 +331,12 @@ static inline void _sse_metrics_k7_n4(const int16_t *val, const int16_t *out,
 	_mm_store_si128((__m128i *) &sums[56], m11);
 }
 
+#ifndef CONV_METRIC_8BIT
 static void gen_metrics_k7_n3(const int8_t *val, const int16_t *out,
-		       int16_t *sums, int16_t *paths, int norm)
+		       int16_t *sums, uint8_t *paths, int norm)
 {
 	const int16_t _val[8] = { val[0], val[1], val[2], 0, val[0], val[1], val[2], 0 };
 
 	_sse_metrics_k7_n4(_val, out, sums, paths, norm);
 }
+#endif
@@ -0,0 +1,304 @@
+/*
+ * Viterbi decoder for convolutional codes - 8-bit path metrics
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "conv_kernels.h"
+
+#if defined(HAVE_AVX2)
+#include <immintrin.h>
+#elif defined(HAVE_SSE3)
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#endif
+
+/* Scale a soft bit, rounding towards zero to keep the range symmetric */
+static inline int u8_scale(int8_t val)
+{
+	if (val < -INT8_MAX)
+		val = -INT8_MAX;
+
+	return val / (1 << U8_SOFT_SHIFT);
+}
+
+#if defined(HAVE_AVX2)
+/*
+ * Two lane deinterleaving K = 7
+ *
+ * Split 64 interleaved 8-bit path metrics into 32 even and 32 odd states.
+ * Bytes are grouped within each 128-bit lane first, then the 64-bit
+ * quarters are gathered across lanes.
+ *
+ * Input:
+ * M0:1 - Path metrics of states 0-31 and 32-63
+ *
+ * Output:
+ * M2   - Path metrics of the 32 even states
+ * M3   - Path metrics of the 32 odd states
+ */
+#define AVX2_U8_DEINTERLEAVE_K7(M0,M1,M2,M3) \
+{ \
+	const __m256i _mask = _mm256_setr_epi8( \
+		0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15, \
+		0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15); \
+	M0 = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(M0, _mask), \
+				      _MM_SHUFFLE(3, 1, 2, 0)); \
+	M1 = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(M1, _mask), \
+				      _MM_SHUFFLE(3, 1, 2, 0)); \
+	M2 = _mm256_permute2x128_si256(M0, M1, 0x20); \
+	M3 = _mm256_permute2x128_si256(M0, M1, 0x31); \
+}
+
+static void gen_metrics_k7_n3_u8(const int8_t *seq, const int8_t *out,
+				 uint8_t *sums, uint8_t *paths, int norm)
+{
+	uint32_t lo_bits, hi_bits;
+	int v0 = u8_scale(seq[0]), v1 = u8_scale(seq[1]), v2 = u8_scale(seq[2]);
+	__m256i m0, m1, m2, m3, m4, m5, m6;
+
+	/* (BMU) Costs of the branches from the even states */
+	m0 = _mm256_sign_epi8(_mm256_set1_epi8(v0), _mm256_loadu_si256((__m256i *) &out[0]));
+	m1 = _mm256_sign_epi8(_mm256_set1_epi8(v1), _mm256_loadu_si256((__m256i *) &out[32]));
+	m2 = _mm256_sign_epi8(_mm256_set1_epi8(v2), _mm256_loadu_si256((__m256i *) &out[64]));
+	m0 = _mm256_add_epi8(_mm256_add_epi8(m0, m1), m2);
+	m1 = _mm256_set1_epi8(abs(v0) + abs(v1) + abs(v2));
+	m0 = _mm256_avg_epu8(_mm256_sub_epi8(m1, m0), _mm256_setzero_si256());
+	m1 = _mm256_sub_epi8(m1, m0);
+
+	/* (PMU) Load and deinterleave accumulated path metrics */
+	m2 = _mm256_loadu_si256((__m256i *) &sums[0]);
+	m3 = _mm256_loadu_si256((__m256i *) &sums[32]);
+	AVX2_U8_DEINTERLEAVE_K7(m2, m3, m4, m5)
+
+	/* (PMU) Butterflies */
+	m2 = _mm256_adds_epu8(m5, m1);
+	m3 = _mm256_adds_epu8(m5, m0);
+	m6 = _mm256_min_epu8(_mm256_adds_epu8(m4, m0), m2);
+	m5 = _mm256_min_epu8(_mm256_adds_epu8(m4, m1), m3);
+	lo_bits = ~_mm256_movemask_epi8(_mm256_cmpeq_epi8(m6, m2));
+	hi_bits = ~_mm256_movemask_epi8(_mm256_cmpeq_epi8(m5, m3));
+
+	memcpy(&paths[0], &lo_bits, sizeof(lo_bits));
+	memcpy(&paths[4], &hi_bits, sizeof(hi_bits));
+
+	if (norm) {
+		__m128i min;
+
+		m0 = _mm256_min_epu8(m6, m5);
+		min = _mm_min_epu8(_mm256_castsi256_si128(m0),
+				   _mm256_extracti128_si256(m0, 1));
+		min = _mm_min_epu8(min, _mm_srli_si128(min, 8));
+		min = _mm_min_epu8(min, _mm_srli_si128(min, 4));
+		min = _mm_min_epu8(min, _mm_srli_si128(min, 2));
+		min = _mm_min_epu8(min, _mm_srli_si128(min, 1));
+		m0 = _mm256_broadcastb_epi8(min);
+
+		m6 = _mm256_subs_epu8(m6, m0);
+		m5 = _mm256_subs_epu8(m5, m0);
+	}
+
+	_mm256_storeu_si256((__m256i *) &sums[0], m6);
+	_mm256_storeu_si256((__m256i *) &sums[32], m5);
+}
+#elif defined(HAVE_SSE3)
+/*
+ * Two lane deinterleaving K = 7
+ *
+ * Split 64 interleaved 8-bit path metrics into 32 even and 32 odd states.
+ *
+ * Input:
+ * M0:3 - Path metrics of states 0-15, 16-31, 32-47 and 48-63
+ *
+ * Output:
+ * M4:5 - Path metrics of even states 0-30 and 32-62
+ * M6:7 - Path metrics of odd states 1-31 and 33-63
+ */
+#define SSE_U8_DEINTERLEAVE_K7(M0,M1,M2,M3,M4,M5,M6,M7) \
+{ \
+	M4 = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, \
+			   1, 3, 5, 7, 9, 11, 13, 15); \
+	M0 = _mm_shuffle_epi8(M0, M4); \
+	M1 = _mm_shuffle_epi8(M1, M4); \
+	M2 = _mm_shuffle_epi8(M2, M4); \
+	M3 = _mm_shuffle_epi8(M3, M4); \
+	M4 = _mm_unpacklo_epi64(M0, M1); \
+	M5 = _mm_unpacklo_epi64(M2, M3); \
+	M6 = _mm_unpackhi_epi64(M0, M1); \
+	M7 = _mm_unpackhi_epi64(M2, M3); \
+}
+
+/*
+ * Generate branch costs N = 3
+ *
+ * Compute 16 costs of the branches from the even states, and the costs of
+ * the complementary branches.
+ *
+ * Input:
+ * M0:2 - Broadcast scaled soft input values
+ * M3   - Broadcast sum of the scaled soft input magnitudes
+ * O    - Trellis outputs, first plane
+ *
+ * Output:
+ * M4   - Branch costs to the lower half states
+ * M5   - Branch costs to the upper half states
+ */
+#define SSE_U8_BRANCH_COST_N3(M0,M1,M2,M3,O,M4,M5) \
+{ \
+	M4 = _mm_add_epi8( \
+		_mm_sign_epi8(M0, _mm_loadu_si128((__m128i *) &(O)[0])), \
+		_mm_sign_epi8(M1, _mm_loadu_si128((__m128i *) &(O)[32]))); \
+	M4 = _mm_add_epi8(M4, \
+		_mm_sign_epi8(M2, _mm_loadu_si128((__m128i *) &(O)[64]))); \
+	M4 = _mm_avg_epu8(_mm_sub_epi8(M3, M4), _mm_setzero_si128()); \
+	M5 = _mm_sub_epi8(M3, M4); \
+}
+
+/*
+ * Octo-Viterbi butterfly, 8-bit costs
+ *
+ * Compute 16-wide butterfly generating 32 path decisions and 32 path
+ * costs.
+ *
+ * Input:
+ * M0 - Even state path costs
+ * M1 - Odd state path costs
+ * M2 - Branch costs from the even states to the lower half states
+ * M3 - Branch costs from the even states to the upper half states
+ *
+ * Output:
+ * M4 - Selected path costs, lower half states
+ * M5 - Selected path costs, upper half states
+ * D0 - Path decisions, lower half states
+ * D1 - Path decisions, upper half states
+ */
+#define SSE_U8_BUTTERFLY(M0,M1,M2,M3,M4,M5,D0,D1) \
+{ \
+	__m128i _c0 = _mm_adds_epu8(M1, M3); \
+	__m128i _c1 = _mm_adds_epu8(M1, M2); \
+	M4 = _mm_min_epu8(_mm_adds_epu8(M0, M2), _c0); \
+	M5 = _mm_min_epu8(_mm_adds_epu8(M0, M3), _c1); \
+	D0 = ~_mm_movemask_epi8(_mm_cmpeq_epi8(M4, _c0)); \
+	D1 = ~_mm_movemask_epi8(_mm_cmpeq_epi8(M5, _c1)); \
+}
+
+static void gen_metrics_k7_n3_u8(const int8_t *seq, const int8_t *out,
+				 uint8_t *sums, uint8_t *paths, int norm)
+{
+	uint16_t bits[4];
+	int v0 = u8_scale(seq[0]), v1 = u8_scale(seq[1]), v2 = u8_scale(seq[2]);
+	__m128i m0, m1, m2, m3, m4, m5, m6, m7;
+	__m128i s0, s1, s2, s3;
+
+	s0 = _mm_set1_epi8(v0);
+	s1 = _mm_set1_epi8(v1);
+	s2 = _mm_set1_epi8(v2);
+	s3 = _mm_set1_epi8(abs(v0) + abs(v1) + abs(v2));
+
+	/* (PMU) Load and deinterleave accumulated path metrics */
+	m0 = _mm_loadu_si128((__m128i *) &sums[0]);
+	m1 = _mm_loadu_si128((__m128i *) &sums[16]);
+	m2 = _mm_loadu_si128((__m128i *) &sums[32]);
+	m3 = _mm_loadu_si128((__m128i *) &sums[48]);
+	SSE_U8_DEINTERLEAVE_K7(m0, m1, m2, m3, m4, m5, m6, m7)
+
+	/* (BMU) Costs of the branches from the even states */
+	SSE_U8_BRANCH_COST_N3(s0, s1, s2, s3, &out[0], m0, m2)
+	SSE_U8_BRANCH_COST_N3(s0, s1, s2, s3, &out[16], m1, m3)
+
+	/* (PMU) Butterflies: 0-15 and 32-47, then 16-31 and 48-63 */
+	SSE_U8_BUTTERFLY(m4, m6, m0, m2, m0, m2, bits[0], bits[2])
+	SSE_U8_BUTTERFLY(m5, m7, m1, m3, m1, m3, bits[1], bits[3])
+
+	memcpy(paths, bits, sizeof(bits));
+
+	if (norm) {
+		m4 = _mm_min_epu8(_mm_min_epu8(m0, m1), _mm_min_epu8(m2, m3));
+		m4 = _mm_min_epu8(m4, _mm_srli_si128(m4, 8));
+		m4 = _mm_min_epu8(m4, _mm_srli_si128(m4, 4));
+		m4 = _mm_min_epu8(m4, _mm_srli_si128(m4, 2));
+		m4 = _mm_min_epu8(m4, _mm_srli_si128(m4, 1));
+		m4 = _mm_shuffle_epi8(m4, _mm_setzero_si128());
+
+		m0 = _mm_subs_epu8(m0, m4);
+		m1 = _mm_subs_epu8(m1, m4);
+		m2 = _mm_subs_epu8(m2, m4);
+		m3 = _mm_subs_epu8(m3, m4);
+	}
+
+	_mm_storeu_si128((__m128i *) &sums[0], m0);
+	_mm_storeu_si128((__m128i *) &sums[16], m1);
+	_mm_storeu_si128((__m128i *) &sums[32], m2);
+	_mm_storeu_si128((__m128i *) &sums[48], m3);
+}
+#else
+static inline uint8_t u8_adds(uint8_t a, uint8_t b)
+{
+	return a + b > UINT8_MAX ? UINT8_MAX : a + b;
+}
+
+static void gen_metrics_k7_n3_u8(const int8_t *seq, const int8_t *out,
+				 uint8_t *sums, uint8_t *paths, int norm)
+{
+	int i, j;
+	uint8_t min;
+	uint8_t new_sums[64], sel[64];
+	int v0 = u8_scale(seq[0]), v1 = u8_scale(seq[1]), v2 = u8_scale(seq[2]);
+	int m = abs(v0) + abs(v1) + abs(v2);
+
+	for (i = 0; i < 32; i++) {
+		uint8_t a, c0, c1, c2, c3;
+
+		a = (m - (v0 * out[i] + v1 * out[32 + i] + v2 * out[64 + i])) / 2;
+
+		c0 = u8_adds(sums[2 * i + 0], a);
+		c1 = u8_adds(sums[2 * i + 1], m - a);
+		c2 = u8_adds(sums[2 * i + 0], m - a);
+		c3 = u8_adds(sums[2 * i + 1], a);
+
+		new_sums[i] = c0 < c1 ? c0 : c1;
+		new_sums[i + 32] = c2 < c3 ? c2 : c3;
+		sel[i] = c0 < c1;
+		sel[i + 32] = c2 < c3;
+	}
+
+	for (i = 0; i < 8; i++) {
+		uint8_t bits = 0;
+
+		for (j = 0; j < 8; j++)
+			bits |= sel[8 * i + j] << j;
+
+		paths[i] = bits;
+	}
+
+	if (norm) {
+		min = new_sums[0];
+		for (i = 1; i < 64; i++) {
+			if (new_sums[i] < min)
+				min = new_sums[i];
+		}
+
+		for (i = 0; i < 64; i++)
+			new_sums[i] -= min;
+	}
+
+	memcpy(sums, new_sums, sizeof(new_sums));
+}
+#endif
@@ -13,6 +13,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "conv.h"
@@ -97,7 +98,7 @@ static void interleaver_ma1(decode_t *st)
         st->mu[DIVERSITY_DELAY_AM + n] = bit_map(st->buffer_pu, b, k, p);
     }
 
-    if (st->input->sync.psmi != SERVICE_MODE_MA3)
+    if (st->psmi != SERVICE_MODE_MA3)
     {
         for (int n = 0; n < 12000; n++)
         {
@@ -144,136 +145,121 @@ static void interleaver_ma1(decode_t *st)
     {
         for (int j = 0; j < 3; j++)
         {
-            st->p1_am[i*12 + bl_delay[j]] = st->bl[i*3 + j];
-            st->p1_am[i*12 + ml_delay[j]] = st->ml[i*3 + j];
-            st->p1_am[i*12 + bu_delay[j]] = st->bu[i*3 + j];
-            st->p1_am[i*12 + mu_delay[j]] = st->mu[i*3 + j];
+            st->viterbi_p1_am[i*12 + bl_delay[j]] = st->bl[i*3 + j] ? 1 : -1;
+            st->viterbi_p1_am[i*12 + ml_delay[j]] = st->ml[i*3 + j] ? 1 : -1;
+            st->viterbi_p1_am[i*12 + bu_delay[j]] = st->bu[i*3 + j] ? 1 : -1;
+            st->viterbi_p1_am[i*12 + mu_delay[j]] = st->mu[i*3 + j] ? 1 : -1;
         }
-        if (st->input->sync.psmi != SERVICE_MODE_MA3)
+        if (st->psmi != SERVICE_MODE_MA3)
         {
             for (int j = 0; j < 2; j++)
             {
-                st->p3_am[i*6 + el_delay[j]] = st->el[i*2 + j];
+                st->viterbi_p3_am[i*6 + el_delay[j]] = st->el[i*2 + j] ? 1 : -1;
             }
             for (int j = 0; j < 4; j++)
             {
-                st->p3_am[i*6 + eu_delay[j]] = st->eu[i*4 + j];
+                st->viterbi_p3_am[i*6 + eu_delay[j]] = st->eu[i*4 + j] ? 1 : -1;
             }
         }
         else
         {
             for (int j = 0; j < 3; j++)
             {
-                st->p3_am[i*12 + bl_delay[j]] = st->ebl[i*3 + j];
-                st->p3_am[i*12 + ml_delay[j]] = st->eml[i*3 + j];
-                st->p3_am[i*12 + bu_delay[j]] = st->ebu[i*3 + j];
-                st->p3_am[i*12 + mu_delay[j]] = st->emu[i*3 + j];
+                st->viterbi_p3_am[i*12 + bl_delay[j]] = st->ebl[i*3 + j] ? 1 : -1;
+                st->viterbi_p3_am[i*12 + ml_delay[j]] = st->eml[i*3 + j] ? 1 : -1;
+                st->viterbi_p3_am[i*12 + bu_delay[j]] = st->ebu[i*3 + j] ? 1 : -1;
+                st->viterbi_p3_am[i*12 + mu_delay[j]] = st->emu[i*3 + j] ? 1 : -1;
             }
         }
     }
 
     memmove(st->ml, st->ml + 18000, DIVERSITY_DELAY_AM);
     memmove(st->mu, st->mu + 18000, DIVERSITY_DELAY_AM);
-    if (st->input->sync.psmi == SERVICE_MODE_MA3)
+    if (st->psmi == SERVICE_MODE_MA3)
     {
         memmove(st->eml, st->eml + 18000, DIVERSITY_DELAY_AM);
         memmove(st->emu, st->emu + 18000, DIVERSITY_DELAY_AM);
     }
+}
 
-    int offset = 0;
-    for (int i = 0; i < 8 * P1_FRAME_LEN_AM * 3; i++)
-    {
-        switch (i % 15)
-        {
-        case 1:
-        case 4:
-        case 7:
-            st->viterbi_p1_am[i] = 0;
-            break;
-        default:
-            st->viterbi_p1_am[i] = st->p1_am[offset++] ? 1 : -1;
-        }
-    }
+/* transmitted encoder outputs per trellis step, bit n for generator n */
+static const uint8_t puncture_2_5[] = { 7, 3 };
+static const uint8_t puncture_5_12[] = { 5, 5, 5, 7, 7 };
+static const uint8_t puncture_2_3[] = { 5, 1 };
 
-    offset = 0;
-    if (st->input->sync.psmi != SERVICE_MODE_MA3)
-    {
-        for (int i = 0; i < P3_FRAME_LEN_MA1 * 3; i++)
-        {
-            switch (i % 6)
-            {
-            case 1:
-            case 4:
-            case 5:
-                st->viterbi_p3_am[i] = 0;
-                break;
-            default:
-                st->viterbi_p3_am[i] = st->p3_am[offset++] ? 1 : -1;
-            }
-        }
-    }
-    else
+// tabulate the encoder outputs for every encoder state, bit n for generator n
+static void encoder_table_init(uint8_t *table, const struct lte_conv_code *code)
+{
+    for (unsigned int r = 0; r < (1u << code->k); r++)
     {
-        for (int i = 0; i < P3_FRAME_LEN_MA3 * 3; i++)
-        {
-            switch (i % 15)
-            {
-            case 1:
-            case 4:
-            case 7:
-                st->viterbi_p3_am[i] = 0;
-                break;
-            default:
-                st->viterbi_p3_am[i] = st->p3_am[offset++] ? 1 : -1;
-            }
-        }
+        table[r] = __builtin_parity(r & code->gen[0])
+                 | (__builtin_parity(r & code->gen[1]) << 1)
+                 | (__builtin_parity(r & code->gen[2]) << 2);
     }
 }
 
-// calculate number of bit errors by re-encoding and comparing to the input
-static int bit_errors(int8_t *coded, uint8_t *decoded, const unsigned int k, unsigned int frame_len,
-                      const unsigned int gens[3],
-                      const uint8_t *puncture, const int puncture_len)
+// calculate number of bit errors by re-encoding and comparing to the punctured input
+static int bit_errors(const int8_t *coded, const uint8_t *decoded, const unsigned int k, const unsigned int frame_len,
+                      const uint8_t *table, const uint8_t *puncture, const unsigned int puncture_len)
 {
-    uint16_t r = 0;
-    unsigned int i, j, errors = 0;
+    unsigned int r = 0, i, p = 0, errors = 0;
 
     // tail biting
     for (i = 0; i < (k-1); i++)
         r = (r >> 1) | (decoded[frame_len - (k-1) + i] << (k-1));
 
-    for (i = 0, j = 0; i < frame_len; i++, j += 3)
+    for (i = 0; i < frame_len; i++)
     {
+        const unsigned int mask = puncture[p];
+        unsigned int rx = 0, diff;
+
         // shift in new bit
         r = (r >> 1) | (decoded[i] << (k-1));
 
-        if (puncture[j % puncture_len] && ((coded[j] > 0) != __builtin_parity(r & gens[0])))
-            errors++;
-        if (puncture[(j+1) % puncture_len] && ((coded[j+1] > 0) != __builtin_parity(r & gens[1])))
-            errors++;
-        if (puncture[(j+2) % puncture_len] && ((coded[j+2] > 0) != __builtin_parity(r & gens[2])))
-            errors++;
+        // hard decisions of the transmitted bits
+        if (mask & 1)
+            rx |= (*coded++ > 0);
+        if (mask & 2)
+            rx |= (*coded++ > 0) << 1;
+        if (mask & 4)
+            rx |= (*coded++ > 0) << 2;
+
+        diff = (table[r] ^ rx) & mask;
+        errors += (diff & 1) + ((diff >> 1) & 1) + (diff >> 2);
+
+        if (++p == puncture_len)
+            p = 0;
     }
 
     return errors;
 }
 
-static int bit_errors_2_5_fm(int8_t *coded, uint8_t *decoded, const int len)
+static int bit_errors_2_5_fm(const decode_t *st, const int8_t *coded, const uint8_t *decoded, const int len)
 {
-    const uint8_t puncture[] = {1, 1, 1, 1, 1, 0};
-    return bit_errors(coded, decoded, conv_code_k7.k, len, conv_code_k7.gen, puncture, 6);
+    return bit_errors(coded, decoded, conv_code_k7.k, len, st->encoder_k7, puncture_2_5, sizeof(puncture_2_5));
 }
 
-static int bit_errors_e1(int8_t *coded, uint8_t *decoded, const int len)
+static int bit_errors_e1(const decode_t *st, const int8_t *coded, const uint8_t *decoded, const int len)
 {
-    const uint8_t puncture[] = {1, 0, 1, 1, 0, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1};
-    return bit_errors(coded, decoded, conv_code_e1.k, len, conv_code_e1.gen, puncture, 15);
+    return bit_errors(coded, decoded, conv_code_e1.k, len, st->encoder_e1, puncture_5_12, sizeof(puncture_5_12));
 }
 
-static int bit_errors_e2(int8_t *coded, uint8_t *decoded, const int len)
+static int bit_errors_e2(const decode_t *st, const int8_t *coded, const uint8_t *decoded, const int len)
 {
-    const uint8_t puncture[] = {1, 0, 1, 1, 0, 0};
-    return bit_errors(coded, decoded, conv_code_e2_e3.k, len, conv_code_e2_e3.gen, puncture, 6);
+    return bit_errors(coded, decoded, conv_code_e2_e3.k, len, st->encoder_e2, puncture_2_3, sizeof(puncture_2_3));
+}
+
+// sample the bit error rate once every ber_interval frames
+static int ber_sample(decode_t *st)
+{
+    const unsigned int interval = atomic_load_explicit(&st->ber_interval, memory_order_relaxed);
+
+    if (interval == 0)
+        return 0;
+    if (++st->ber_count < interval)
+        return 0;
+    st->ber_count = 0;
+    return 1;
 }
 
 static void descramble(uint8_t *buf, unsigned int length)
@@ -316,8 +302,6 @@ static void interleaver_i(const int8_t* in,
         const unsigned int row = (k * 11) % 32;
         const unsigned int column = (k * 11 + k / (32 * 9)) % C;
         viterbi[out++] = in[(block * 32 + row) * (J * C) + partition * C + column];
-        if ((out % 6) == 5) // depuncture, [1, 1, 1, 1, 1, 0]
-            viterbi[out++] = 0;
     }
 }
 
@@ -336,8 +320,6 @@ static void interleaver_ii(const int8_t* in, int8_t* viterbi, const unsigned int
         const unsigned int row = (k * 11) % 32;
         const unsigned int column = (k * 11 + k / (32 * 9)) % C;
         viterbi[out++] = in[(block * 32 + row) * (J * C) + partition * C + column];
-        if ((out % 6) == 5) // depuncture, [1, 1, 1, 1, 1, 0]
-            viterbi[out++] = 0;
     };
 }
 
@@ -367,15 +349,13 @@ void interleaver_iv(interleaver_iv_t* interleaver, int8_t* viterbi, const unsign
         const unsigned int row = ((11 * pti) % bk_bits) / C;
         const unsigned int column = (pti * 11) % C;
         viterbi[out++] = interleaver->internal[(block * 32 + row) * (J * C) + partition * C + column];
-        if ((out % 6) == 1 || (out % 6) == 4) // depuncture, [1, 0, 1, 1, 0, 1]
-            viterbi[out++] = 0;
 
         interleaver->internal[interleaver->i] = interleaver->buffer[i];
         interleaver->i++;
     }
 }
 
-void decode_push_pm(decode_t *st, const int8_t* sbit, const unsigned int bc)
+static void fec_push_pm(decode_t *st, const int8_t* sbit, const unsigned int bc)
 {
     memcpy(st->buffer_pm + PM_BLOCK_SIZE * bc, sbit, PM_BLOCK_SIZE * sizeof(int8_t));
     decode_process_pids(st, bc);
@@ -390,7 +370,7 @@ void decode_push_pm(decode_t *st, const int8_t* sbit, const unsigned int bc)
     }
 }
 
-void decode_push_px1(decode_t *st, const int8_t* sbit, const unsigned int len, const unsigned int bc)
+static void fec_push_px1(decode_t *st, const int8_t* sbit, const unsigned int len, const unsigned int bc)
 {
     if (bc % 2 == 0)
         st->interleaver_px1.started = 1;
@@ -405,7 +385,7 @@ void decode_push_px1(decode_t *st, const int8_t* sbit, const unsigned int len, c
 
             if (st->interleaver_px1.ready)
             {
-                nrsc5_conv_decode_p3_p4(st->viterbi_p3, st->scrambler_p3, len);
+                nrsc5_conv_decode(st->vdec_p3_p4, st->viterbi_p3, st->scrambler_p3, len);
                 descramble(st->scrambler_p3, len);
                 frame_push(&st->input->frame, st->scrambler_p3, len, P3_LOGICAL_CHANNEL);
             }
@@ -413,7 +393,7 @@ void decode_push_px1(decode_t *st, const int8_t* sbit, const unsigned int len, c
     }
 }
 
-void decode_push_px2(decode_t* st, const int8_t* sbit, const unsigned int len, const unsigned int bc)
+static void fec_push_px2(decode_t* st, const int8_t* sbit, const unsigned int len, const unsigned int bc)
 {
     if (bc % 2 == 0)
         st->interleaver_px2.started = 1;
@@ -428,7 +408,7 @@ void decode_push_px2(decode_t* st, const int8_t* sbit, const unsigned int len, c
 
             if (st->interleaver_px2.ready)
             {
-                nrsc5_conv_decode_p3_p4(st->viterbi_p4, st->scrambler_p4, len);
+                nrsc5_conv_decode(st->vdec_p3_p4, st->viterbi_p4, st->scrambler_p4, len);
                 descramble(st->scrambler_p4, len);
                 frame_push(&st->input->frame, st->scrambler_p4, len, P4_LOGICAL_CHANNEL);
             }
@@ -436,7 +416,7 @@ void decode_push_px2(decode_t* st, const int8_t* sbit, const unsigned int len, c
     }
 }
 
-void decode_push_pl_pu_s_t(decode_t* st,
+static void fec_push_pl_pu_s_t(decode_t* st,
     const uint8_t* sym_pl, const uint8_t* sym_pu, const uint8_t* sym_s,
     const uint8_t* sym_t, const unsigned int bc)
 {
@@ -454,8 +434,9 @@ void decode_process_p1(decode_t *st)
     interleaver_i(st->buffer_pm, st->viterbi_p1,
         J, B, C, M, PM_V, PM_V_SIZE, P1_FRAME_LEN_ENCODED_FM);
 
-    nrsc5_conv_decode_p1(st->viterbi_p1, st->scrambler_p1);
-    nrsc5_report_ber(st->input->radio, (float) bit_errors_2_5_fm(st->viterbi_p1, st->scrambler_p1, P1_FRAME_LEN_FM) / P1_FRAME_LEN_ENCODED_FM);
+    nrsc5_conv_decode(st->vdec_p1, st->viterbi_p1, st->scrambler_p1, P1_FRAME_LEN_FM);
+    if (ber_sample(st))
+        nrsc5_report_ber(st->input->radio, (float) bit_errors_2_5_fm(st, st->viterbi_p1, st->scrambler_p1, P1_FRAME_LEN_FM) / P1_FRAME_LEN_ENCODED_FM);
     descramble(st->scrambler_p1, P1_FRAME_LEN_FM);
     frame_push(&st->input->frame, st->scrambler_p1, P1_FRAME_LEN_FM, P1_LOGICAL_CHANNEL);
 }
@@ -463,15 +444,31 @@ void decode_process_p1(decode_t *st)
 void decode_process_pids(decode_t *st, const unsigned int bc)
 {
     const int J = 20, B = 16, C = 36;
-    interleaver_ii(st->buffer_pm, st->viterbi_pids, (int)bc, J, B, C, PM_V, PM_V_SIZE, PIDS_FRAME_LEN_ENCODED_FM,
-        P1_FRAME_LEN_ENCODED_FM);
+    interleaver_ii(st->buffer_pm, st->viterbi_pids + bc * PIDS_FRAME_LEN_ENCODED_FM, (int)bc, J, B, C, PM_V, PM_V_SIZE,
+        PIDS_FRAME_LEN_ENCODED_FM, P1_FRAME_LEN_ENCODED_FM);
 
-    nrsc5_conv_decode_pids(st->viterbi_pids, st->scrambler_pids);
-    descramble(st->scrambler_pids, PIDS_FRAME_LEN);
-    pids_frame_push(&st->pids, st->scrambler_pids);
+    if (bc == 0)
+        st->pids_pending = 0;
+    st->pids_pending++;
+
+    // decode the PIDS frames of a whole P1 frame together
+    if (bc == 15)
+    {
+        const unsigned int first = 16 - st->pids_pending;
+
+        nrsc5_conv_decode_batch(st->vdec_pids, st->viterbi_pids + first * PIDS_FRAME_LEN_ENCODED_FM,
+            st->scrambler_pids + first * PIDS_FRAME_LEN, st->pids_pending, PIDS_FRAME_LEN);
+
+        for (unsigned int i = first; i < 16; i++)
+        {
+            descramble(st->scrambler_pids + i * PIDS_FRAME_LEN, PIDS_FRAME_LEN);
+            pids_frame_push(&st->pids, st->scrambler_pids + i * PIDS_FRAME_LEN);
+        }
+        st->pids_pending = 0;
+    }
 }
 
-void decode_process_pids_am(decode_t *st, const uint8_t* sbit)
+static void fec_push_pids_am(decode_t *st, const uint8_t* sbit)
 {
     uint8_t il[120], iu[120];
 
@@ -491,7 +488,7 @@ void decode_process_pids_am(decode_t *st, const uint8_t* sbit)
     }
 
     /* 1012s.pdf figure 10-5 */
-    const int pids1_disabled = (st->input->sync.psmi == 1) && st->input->sync.rdbi;
+    const int pids1_disabled = (st->psmi == 1) && st->rdbi;
     for (int i = 0; i < 10; i++) {
       for (int j = 0; j < 12; j++) {
         st->viterbi_pids[i*24 + pids_il_delay[j]] = pids1_disabled ? 0 : (il[i*12 + j] ? 1 : -1);
@@ -499,7 +496,7 @@ void decode_process_pids_am(decode_t *st, const uint8_t* sbit)
       }
     }
 
-    nrsc5_conv_decode_e2_e3(st->viterbi_pids, st->scrambler_pids, PIDS_FRAME_LEN);
+    nrsc5_conv_decode(st->vdec_e3, st->viterbi_pids, st->scrambler_pids, PIDS_FRAME_LEN);
     descramble(st->scrambler_pids, PIDS_FRAME_LEN);
     pids_frame_push(&st->pids, st->scrambler_pids);
 }
@@ -507,12 +504,16 @@ void decode_process_pids_am(decode_t *st, const uint8_t* sbit)
 void decode_process_p1_p3_am(decode_t *st, const unsigned int bc)
 {
     if (bc == 0)
+    {
         st->am_errors = 0;
+        st->am_ber = (st->am_diversity_wait == 0) && ber_sample(st);
+    }
 
     if (st->am_diversity_wait == 0)
     {
-        nrsc5_conv_decode_e1(st->viterbi_p1_am + (bc * P1_FRAME_LEN_AM * 3), st->scrambler_p1_am, P1_FRAME_LEN_AM);
-        st->am_errors += bit_errors_e1(st->viterbi_p1_am + (bc * P1_FRAME_LEN_AM * 3), st->scrambler_p1_am, P1_FRAME_LEN_AM);
+        nrsc5_conv_decode(st->vdec_e1, st->viterbi_p1_am + (bc * P1_FRAME_LEN_ENCODED_AM), st->scrambler_p1_am, P1_FRAME_LEN_AM);
+        if (st->am_ber)
+            st->am_errors += bit_errors_e1(st, st->viterbi_p1_am + (bc * P1_FRAME_LEN_ENCODED_AM), st->scrambler_p1_am, P1_FRAME_LEN_AM);
         descramble(st->scrambler_p1_am, P1_FRAME_LEN_AM);
         frame_push(&st->input->frame, st->scrambler_p1_am, P1_FRAME_LEN_AM, P1_LOGICAL_CHANNEL);
 
@@ -520,27 +521,30 @@ void decode_process_p1_p3_am(decode_t *st, const unsigned int bc)
         {
             unsigned int total_frame_length = 8 * P1_FRAME_LEN_ENCODED_AM;
 
-            if (!st->input->sync.rdbi)
+            if (!st->rdbi)
             {
-                if (st->input->sync.psmi != SERVICE_MODE_MA3)
+                if (st->psmi != SERVICE_MODE_MA3)
                 {
                     total_frame_length += P3_FRAME_LEN_ENCODED_MA1;
-                    nrsc5_conv_decode_e2_e3(st->viterbi_p3_am, st->scrambler_p3_am, P3_FRAME_LEN_MA1);
-                    st->am_errors += bit_errors_e2(st->viterbi_p3_am, st->scrambler_p3_am, P3_FRAME_LEN_MA1);
+                    nrsc5_conv_decode(st->vdec_e2, st->viterbi_p3_am, st->scrambler_p3_am, P3_FRAME_LEN_MA1);
+                    if (st->am_ber)
+                        st->am_errors += bit_errors_e2(st, st->viterbi_p3_am, st->scrambler_p3_am, P3_FRAME_LEN_MA1);
                     descramble(st->scrambler_p3_am, P3_FRAME_LEN_MA1);
                     frame_push(&st->input->frame, st->scrambler_p3_am, P3_FRAME_LEN_MA1, P3_LOGICAL_CHANNEL);
                 }
                 else
                 {
                     total_frame_length += P3_FRAME_LEN_ENCODED_MA3;
-                    nrsc5_conv_decode_e1(st->viterbi_p3_am, st->scrambler_p3_am, P3_FRAME_LEN_MA3);
-                    st->am_errors += bit_errors_e1(st->viterbi_p3_am, st->scrambler_p3_am, P3_FRAME_LEN_MA3);
+                    nrsc5_conv_decode(st->vdec_e1, st->viterbi_p3_am, st->scrambler_p3_am, P3_FRAME_LEN_MA3);
+                    if (st->am_ber)
+                        st->am_errors += bit_errors_e1(st, st->viterbi_p3_am, st->scrambler_p3_am, P3_FRAME_LEN_MA3);
                     descramble(st->scrambler_p3_am, P3_FRAME_LEN_MA3);
                     frame_push(&st->input->frame, st->scrambler_p3_am, P3_FRAME_LEN_MA3, P3_LOGICAL_CHANNEL);
                 }
             }
 
-            nrsc5_report_ber(st->input->radio, (float) st->am_errors / (float) total_frame_length);
+            if (st->am_ber)
+                nrsc5_report_ber(st->input->radio, (float) st->am_errors / (float) total_frame_length);
         }
     }
 
@@ -561,19 +565,264 @@ static void interleaver_iv_reset(interleaver_iv_t *interleaver)
     interleaver->ready = 0;
 }
 
-void decode_reset(decode_t *st)
+static void fec_reset(decode_t *st)
 {
     st->idx_pm = 0;
     st->started_pm = 0;
+    st->pids_pending = 0;
     st->am_errors = 0;
+    st->am_ber = 0;
     st->am_diversity_wait = 4;
+    st->ber_count = 0;
     interleaver_iv_reset(&st->interleaver_px1);
     interleaver_iv_reset(&st->interleaver_px2);
     pids_init(&st->pids, st->input);
 }
 
+static void fec_process(decode_t *st, fec_block_t *blk)
+{
+    st->gen = blk->gen;
+    st->psmi = blk->psmi;
+    st->rdbi = blk->rdbi;
+
+    switch (blk->type)
+    {
+    case FEC_PM:
+        fec_push_pm(st, blk->data, blk->bc);
+        break;
+    case FEC_PX1:
+        fec_push_px1(st, blk->data, blk->len, blk->bc);
+        break;
+    case FEC_PX2:
+        fec_push_px2(st, blk->data, blk->len, blk->bc);
+        break;
+    case FEC_PIDS_AM:
+        fec_push_pids_am(st, (uint8_t *) blk->data);
+        break;
+    case FEC_PL_PU_S_T:
+    {
+        const unsigned int len = BLKSZ * PARTITION_WIDTH_AM;
+        const uint8_t *sym = (uint8_t *) blk->data;
+        fec_push_pl_pu_s_t(st, sym, sym + len, sym + 2 * len, sym + 3 * len, blk->bc);
+        break;
+    }
+    case FEC_ADVANCE:
+        output_advance(st->input->output);
+        break;
+    case FEC_RESET:
+        fec_reset(st);
+        frame_reset(&st->input->frame);
+        break;
+    }
+}
+
+static void fec_wake(decode_t *st)
+{
+    pthread_mutex_lock(&st->fec_mutex);
+    pthread_cond_broadcast(&st->fec_cond);
+    pthread_mutex_unlock(&st->fec_mutex);
+}
+
+static void *fec_worker(void *arg)
+{
+    decode_t *st = arg;
+
+    while (1)
+    {
+        const unsigned int tail = atomic_load_explicit(&st->fec_tail, memory_order_relaxed);
+        fec_block_t *blk = &st->fec_ring[tail % FEC_RING_LEN];
+
+        if (atomic_load(&st->fec_head) == tail)
+        {
+            // the ring is empty, sleep until the demodulator commits a block
+            pthread_mutex_lock(&st->fec_mutex);
+            atomic_store(&st->fec_sleeping, 1);
+            while (atomic_load(&st->fec_head) == tail)
+                pthread_cond_wait(&st->fec_cond, &st->fec_mutex);
+            atomic_store(&st->fec_sleeping, 0);
+            pthread_mutex_unlock(&st->fec_mutex);
+        }
+
+        if (blk->type == FEC_QUIT)
+            break;
+
+        fec_process(st, blk);
+
+        atomic_store(&st->fec_tail, tail + 1);
+        if (atomic_load(&st->fec_waiting))
+            fec_wake(st);
+    }
+    return NULL;
+}
+
+// wait until at most 'pending' blocks are queued
+static void fec_wait(decode_t *st, unsigned int pending)
+{
+    const unsigned int head = atomic_load_explicit(&st->fec_head, memory_order_relaxed);
+
+    if (head - atomic_load(&st->fec_tail) <= pending)
+        return;
+
+    pthread_mutex_lock(&st->fec_mutex);
+    atomic_store(&st->fec_waiting, 1);
+    while (head - atomic_load(&st->fec_tail) > pending)
+        pthread_cond_wait(&st->fec_cond, &st->fec_mutex);
+    atomic_store(&st->fec_waiting, 0);
+    pthread_mutex_unlock(&st->fec_mutex);
+}
+
+static fec_block_t *fec_next(decode_t *st, int type)
+{
+    const unsigned int head = atomic_load_explicit(&st->fec_head, memory_order_relaxed);
+    fec_block_t *blk = &st->fec_ring[head % FEC_RING_LEN];
+
+    // frames stopped decoding in the current sync
+    if (atomic_exchange(&st->fec_resync, 0) == st->fec_gen + 1)
+        input_set_sync_state(st->input, SYNC_STATE_NONE);
+
+    fec_wait(st, FEC_RING_LEN - 1);
+
+    blk->type = type;
+    blk->gen = st->fec_gen;
+    blk->psmi = st->input->sync.psmi;
+    blk->rdbi = st->input->sync.rdbi;
+    return blk;
+}
+
+static void fec_commit(decode_t *st)
+{
+    atomic_fetch_add(&st->fec_head, 1);
+    if (atomic_load(&st->fec_sleeping))
+        fec_wake(st);
+}
+
+void decode_push_pm(decode_t *st, const int8_t* sbit, const unsigned int bc)
+{
+    fec_block_t *blk = fec_next(st, FEC_PM);
+    memcpy(blk->data, sbit, PM_BLOCK_SIZE * sizeof(int8_t));
+    blk->bc = bc;
+    fec_commit(st);
+}
+
+void decode_push_px1(decode_t *st, const int8_t* sbit, const unsigned int len, const unsigned int bc)
+{
+    fec_block_t *blk = fec_next(st, FEC_PX1);
+    memcpy(blk->data, sbit, len * sizeof(int8_t));
+    blk->len = len;
+    blk->bc = bc;
+    fec_commit(st);
+}
+
+void decode_push_px2(decode_t *st, const int8_t* sbit, const unsigned int len, const unsigned int bc)
+{
+    fec_block_t *blk = fec_next(st, FEC_PX2);
+    memcpy(blk->data, sbit, len * sizeof(int8_t));
+    blk->len = len;
+    blk->bc = bc;
+    fec_commit(st);
+}
+
+void decode_push_pids_am(decode_t *st, const uint8_t* sbit)
+{
+    fec_block_t *blk = fec_next(st, FEC_PIDS_AM);
+    memcpy(blk->data, sbit, 2 * BLKSZ);
+    fec_commit(st);
+}
+
+void decode_push_pl_pu_s_t(decode_t* st,
+    const uint8_t* sym_pl, const uint8_t* sym_pu, const uint8_t* sym_s,
+    const uint8_t* sym_t, const unsigned int bc)
+{
+    const unsigned int len = BLKSZ * PARTITION_WIDTH_AM;
+    fec_block_t *blk = fec_next(st, FEC_PL_PU_S_T);
+    memcpy(blk->data, sym_pl, len);
+    memcpy(blk->data + len, sym_pu, len);
+    memcpy(blk->data + 2 * len, sym_s, len);
+    memcpy(blk->data + 3 * len, sym_t, len);
+    blk->bc = bc;
+    fec_commit(st);
+}
+
+void decode_push_advance(decode_t *st)
+{
+    fec_next(st, FEC_ADVANCE);
+    fec_commit(st);
+}
+
+void decode_reset(decode_t *st)
+{
+    st->fec_gen++;
+    fec_next(st, FEC_RESET);
+    fec_commit(st);
+}
+
+void decode_flush(decode_t *st)
+{
+    fec_wait(st, 0);
+}
+
+void decode_lost_sync(decode_t *st)
+{
+    atomic_store(&st->fec_resync, st->gen + 1);
+}
+
 void decode_init(decode_t *st, input_t *input)
 {
     st->input = input;
-    decode_reset(st);
+    atomic_init(&st->ber_interval, 1);
+
+    encoder_table_init(st->encoder_k7, &conv_code_k7);
+    encoder_table_init(st->encoder_e1, &conv_code_e1);
+    encoder_table_init(st->encoder_e2, &conv_code_e2_e3);
+
+    st->vdec_p1 = nrsc5_conv_alloc_p1();
+    st->vdec_pids = nrsc5_conv_alloc_pids();
+    st->vdec_p3_p4 = nrsc5_conv_alloc_p3_p4();
+    st->vdec_e1 = nrsc5_conv_alloc_e1();
+    st->vdec_e2 = nrsc5_conv_alloc_e2();
+    st->vdec_e3 = nrsc5_conv_alloc_e3();
+
+    fec_reset(st);
+
+    st->fec_ring = malloc(sizeof(fec_block_t) * FEC_RING_LEN);
+    atomic_init(&st->fec_head, 0);
+    atomic_init(&st->fec_tail, 0);
+    atomic_init(&st->fec_sleeping, 0);
+    atomic_init(&st->fec_waiting, 0);
+    atomic_init(&st->fec_resync, 0);
+    st->fec_gen = 0;
+    pthread_mutex_init(&st->fec_mutex, NULL);
+    pthread_cond_init(&st->fec_cond, NULL);
+    pthread_create(&st->fec_thread, NULL, fec_worker, st);
+}
+
+void decode_free(decode_t *st)
+{
+    // decode the remaining blocks, then stop the FEC thread
+    fec_wait(st, FEC_RING_LEN - 1);
+    st->fec_ring[atomic_load(&st->fec_head) % FEC_RING_LEN].type = FEC_QUIT;
+    fec_commit(st);
+    pthread_join(st->fec_thread, NULL);
+    pthread_cond_destroy(&st->fec_cond);
+    pthread_mutex_destroy(&st->fec_mutex);
+    free(st->fec_ring);
+
+    nrsc5_conv_free(st->vdec_p1);
+    nrsc5_conv_free(st->vdec_pids);
+    nrsc5_conv_free(st->vdec_p3_p4);
+    nrsc5_conv_free(st->vdec_e1);
+    nrsc5_conv_free(st->vdec_e2);
+    nrsc5_conv_free(st->vdec_e3);
+}
+
+// ber_count belongs to the FEC thread, which restarts it once it reaches the new interval
+void decode_set_ber_interval(decode_t *st, unsigned int interval)
+{
+    atomic_store_explicit(&st->ber_interval, interval, memory_order_relaxed);
+}
+
+int decode_set_fec_threads(decode_t *st, int threads)
+{
+    decode_flush(st);
+    return nrsc5_conv_set_threads(st->vdec_p1, threads);
 }
@@ -1,11 +1,31 @@
 #pragma once
 
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdint.h>
+#include "conv.h"
 #include "defines.h"
 #include "pids.h"
 
 #define DIVERSITY_DELAY_AM (18000 * 3)
 
+// soft bit blocks queued between the demodulator and the FEC thread
+#define FEC_RING_LEN 32
+#define FEC_BLOCK_LEN PM_BLOCK_SIZE
+
+enum { FEC_PM, FEC_PX1, FEC_PX2, FEC_PIDS_AM, FEC_PL_PU_S_T, FEC_ADVANCE, FEC_RESET, FEC_QUIT };
+
+typedef struct
+{
+    int type;
+    unsigned int bc;
+    unsigned int len;
+    unsigned int gen;
+    int psmi;
+    int rdbi;
+    int8_t data[FEC_BLOCK_LEN];
+} fec_block_t;
+
 typedef struct
 {
   int8_t buffer[144 * BLKSZ * 2];
@@ -27,6 +47,7 @@ typedef struct
     uint8_t buffer_s[PARTITION_WIDTH_AM * BLKSZ * 8];
     uint8_t buffer_t[PARTITION_WIDTH_AM * BLKSZ * 8];
     unsigned int am_errors;
+    int am_ber;
     unsigned int am_diversity_wait;
 
     uint8_t bl[18000];
@@ -40,40 +61,75 @@ typedef struct
     uint8_t eml[18000 + DIVERSITY_DELAY_AM];
     uint8_t emu[18000 + DIVERSITY_DELAY_AM];
 
-    int8_t viterbi_p1[P1_FRAME_LEN_FM * 3];
+    int8_t viterbi_p1[P1_FRAME_LEN_ENCODED_FM];
     uint8_t scrambler_p1[P1_FRAME_LEN_FM];
-    int8_t viterbi_pids[PIDS_FRAME_LEN * 3];
-    uint8_t scrambler_pids[PIDS_FRAME_LEN];
+    int8_t viterbi_pids[PIDS_FRAME_LEN_ENCODED_AM * 16];
+    uint8_t scrambler_pids[PIDS_FRAME_LEN * 16];
+    unsigned int pids_pending;
     interleaver_iv_t interleaver_px1;
     interleaver_iv_t interleaver_px2;
-    int8_t viterbi_p3[P3_FRAME_LEN_MP3_MP11 * 3];
-    int8_t viterbi_p4[P3_FRAME_LEN_MP3_MP11 * 3];
+    int8_t viterbi_p3[P3_FRAME_LEN_MP3_MP11 * 2];
+    int8_t viterbi_p4[P3_FRAME_LEN_MP3_MP11 * 2];
     uint8_t scrambler_p3[P3_FRAME_LEN_MP3_MP11];
     uint8_t scrambler_p4[P3_FRAME_LEN_MP3_MP11];
 
-    uint8_t p1_am[8 * P1_FRAME_LEN_ENCODED_AM];
-    int8_t viterbi_p1_am[8 * P1_FRAME_LEN_AM * 3];
+    int8_t viterbi_p1_am[8 * P1_FRAME_LEN_ENCODED_AM];
     uint8_t scrambler_p1_am[P1_FRAME_LEN_AM];
-    uint8_t p3_am[P3_FRAME_LEN_ENCODED_MA3];
-    int8_t viterbi_p3_am[P3_FRAME_LEN_MA3 * 3];
+    int8_t viterbi_p3_am[P3_FRAME_LEN_ENCODED_MA3];
     uint8_t scrambler_p3_am[P3_FRAME_LEN_MA3];
 
+    struct vdecoder *vdec_p1;
+    struct vdecoder *vdec_pids;
+    struct vdecoder *vdec_p3_p4;
+    struct vdecoder *vdec_e1;
+    struct vdecoder *vdec_e2;
+    struct vdecoder *vdec_e3;
+
+    uint8_t encoder_k7[1 << 7];
+    uint8_t encoder_e1[1 << 9];
+    uint8_t encoder_e2[1 << 9];
+    atomic_uint ber_interval;
+    unsigned int ber_count;
+
     pids_t pids;
+
+    // single producer, single consumer ring of blocks for the FEC thread
+    fec_block_t *fec_ring;
+    atomic_uint fec_head;
+    atomic_uint fec_tail;
+    atomic_int fec_sleeping;
+    atomic_int fec_waiting;
+    atomic_uint fec_resync;
+    pthread_mutex_t fec_mutex;
+    pthread_cond_t fec_cond;
+    pthread_t fec_thread;
+    unsigned int fec_gen;
+
+    // state of the block being decoded, owned by the FEC thread
+    unsigned int gen;
+    int psmi;
+    int rdbi;
 } decode_t;
 
 void decode_process_p1(decode_t *st);
 void decode_process_pids(decode_t *st, unsigned int bc);
 void decode_process_p3_p4(const decode_t *st, interleaver_iv_t *interleaver, int8_t *viterbi, uint8_t *scrambler, logical_channel_t lc);
-void decode_process_pids_am(decode_t *st, const uint8_t* sbit);
 void decode_process_p1_p3_am(decode_t *st, unsigned int bc);
 
 void decode_push_pm(decode_t *st, const int8_t* sbit, unsigned int bc);
 void decode_push_px1(decode_t *st, const int8_t* sbit, unsigned int len, unsigned int bc);
 void decode_push_px2(decode_t *st, const int8_t* sbit, unsigned int len, unsigned int bc);
+void decode_push_pids_am(decode_t *st, const uint8_t* sbit);
 
 void decode_push_pl_pu_s_t(decode_t *st,
     const uint8_t* sym_pl, const uint8_t* sym_pu, const uint8_t* sym_s, const uint8_t* sym_t,
     unsigned int bc);
+void decode_push_advance(decode_t *st);
 
 void decode_reset(decode_t *st);
+void decode_flush(decode_t *st);
+void decode_lost_sync(decode_t *st);
 void decode_init(decode_t *st, struct input_t *input);
+void decode_free(decode_t *st);
+void decode_set_ber_interval(decode_t *st, unsigned int interval);
+int decode_set_fec_threads(decode_t *st, int threads);
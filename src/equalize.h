@@ -0,0 +1,55 @@
+#pragma once
+
+#include <complex.h>
+
+#include "defines.h"
+#include "vmath.h"
+
+/*
+ * Equalize the data subcarriers of an FM partition. rows[0] and
+ * rows[PARTITION_WIDTH_FM] are the reference subcarriers, with magnitudes
+ * smag0 and smag19 and per-symbol phases lower_phases and upper_phases.
+ *
+ * The channel is interpolated linearly between the two reference
+ * subcarriers, so for data subcarrier k of symbol n it is
+ * k * a[n] + (W - k) * b[n] (scaled by W). Each sample is multiplied by
+ * W * (1 + i) / channel, with the division done as one real reciprocal, so
+ * that the loops vectorize.
+ */
+static inline void equalize_partition(float complex (*rows)[BLKSZ], const float *lower_phases,
+                                      const float *upper_phases, float smag0, float smag19)
+{
+    float a_re[BLKSZ], a_im[BLKSZ], b_re[BLKSZ], b_im[BLKSZ];
+
+    for (int n = 0; n < BLKSZ; n++)
+    {
+        float s, c;
+
+        fast_sincos(upper_phases[n], &s, &c);
+        a_re[n] = smag19 * c;
+        a_im[n] = smag19 * s;
+
+        fast_sincos(lower_phases[n], &s, &c);
+        b_re[n] = smag0 * c;
+        b_im[n] = smag0 * s;
+    }
+
+    for (int k = 1; k < PARTITION_WIDTH_FM; k++)
+    {
+        float complex *buf = rows[k];
+
+        for (int n = 0; n < BLKSZ; n++)
+        {
+            const float d_re = k * a_re[n] + (PARTITION_WIDTH_FM - k) * b_re[n];
+            const float d_im = k * a_im[n] + (PARTITION_WIDTH_FM - k) * b_im[n];
+            // W * (1 + i) * conj(d) / |d|^2
+            const float g = PARTITION_WIDTH_FM / (d_re * d_re + d_im * d_im);
+            const float c_re = g * (d_re + d_im);
+            const float c_im = g * (d_re - d_im);
+            const float x_re = crealf(buf[n]);
+            const float x_im = cimagf(buf[n]);
+
+            buf[n] = CMPLXF(x_re * c_re - x_im * c_im, x_re * c_im + x_im * c_re);
+        }
+    }
+}
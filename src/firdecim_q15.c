@@ -2,16 +2,11 @@
 
 #include <assert.h>
 #include <stdint.h>
-
-#ifdef HAVE_NEON
-#include <arm_neon.h>
-#endif
-
-#ifdef HAVE_SSE2
-#include <emmintrin.h>
-#endif
+#include <string.h>
 
 #include "firdecim_q15.h"
+#include "firdecim_q15_kernels.h"
+#include "simd.h"
 
 #define WINDOW_SIZE 2048
 
@@ -20,8 +15,34 @@ struct firdecim_q15 {
     unsigned int ntaps;
     cint16_t * window;
     unsigned int idx;
+    unsigned int odd;
+    const firdecim_q15_kernels * kernels;
 };
 
+// kernels for the SIMD level chosen at run time
+static const firdecim_q15_kernels *select_kernels(void)
+{
+    switch (simd_level())
+    {
+#ifdef USE_SSE
+    case SIMD_SSE3:
+    case SIMD_SSE41:
+        return &firdecim_q15_kernels_sse2;
+#endif
+#ifdef USE_AVX2
+    case SIMD_AVX2:
+    case SIMD_AVX512:
+        return &firdecim_q15_kernels_avx2;
+#endif
+#ifdef USE_NEON
+    case SIMD_NEON:
+        return &firdecim_q15_kernels_neon;
+#endif
+    default:
+        return &firdecim_q15_kernels_gen;
+    }
+}
+
 firdecim_q15 firdecim_q15_create(const float * taps, unsigned int ntaps)
 {
     firdecim_q15 q;
@@ -30,6 +51,7 @@ firdecim_q15 firdecim_q15_create(const float * taps, unsigned int ntaps)
     q->ntaps = (ntaps == 32) ? 32 : 15;
     q->taps = malloc(sizeof(int16_t) * ntaps * 2);
     q->window = calloc(WINDOW_SIZE, sizeof(cint16_t));
+    q->kernels = select_kernels();
     firdecim_q15_reset(q);
 
     // reverse order so we can push into the window
@@ -53,113 +75,132 @@ void firdecim_q15_free(firdecim_q15 q)
 void firdecim_q15_reset(firdecim_q15 q)
 {
     q->idx = q->ntaps - 1;
+    q->odd = 0;
+}
+
+static void slide(firdecim_q15 q)
+{
+    for (unsigned int i = 0; i < q->ntaps - 1; i++)
+        q->window[i] = q->window[q->idx - q->ntaps + 1 + i];
+    q->idx = q->ntaps - 1;
 }
 
 static void push(firdecim_q15 q, cint16_t x)
 {
     if (q->idx == WINDOW_SIZE)
-    {
-        for (unsigned int i = 0; i < q->ntaps - 1; i++)
-            q->window[i] = q->window[q->idx - q->ntaps + 1 + i];
-        q->idx = q->ntaps - 1;
-    }
+        slide(q);
     q->window[q->idx++] = x;
 }
 
-#ifdef HAVE_NEON
-static cint16_t dotprod_32(cint16_t *a, int16_t *b)
+// make room for up to 'n' samples in the window, returning how many fit
+static unsigned int reserve(firdecim_q15 q, unsigned int n)
 {
-    int16x8_t s1 = vqdmulhq_s16(vld1q_s16((int16_t *)&a[0]), vld1q_s16(&b[0*2]));
-    int16x8_t s2 = vqdmulhq_s16(vld1q_s16((int16_t *)&a[4]), vld1q_s16(&b[4*2]));
-    int16x8_t s3 = vqdmulhq_s16(vld1q_s16((int16_t *)&a[8]), vld1q_s16(&b[8*2]));
-    int16x8_t s4 = vqdmulhq_s16(vld1q_s16((int16_t *)&a[12]), vld1q_s16(&b[12*2]));
-    int16x8_t sum = vqaddq_s16(vqaddq_s16(s1, s2), vqaddq_s16(s3, s4));
-
-    s1 = vqdmulhq_s16(vld1q_s16((int16_t *)&a[16]), vld1q_s16(&b[16*2]));
-    s2 = vqdmulhq_s16(vld1q_s16((int16_t *)&a[20]), vld1q_s16(&b[20*2]));
-    s3 = vqdmulhq_s16(vld1q_s16((int16_t *)&a[24]), vld1q_s16(&b[24*2]));
-    s4 = vqdmulhq_s16(vld1q_s16((int16_t *)&a[28]), vld1q_s16(&b[28*2]));
-    sum = vqaddq_s16(vqaddq_s16(s1, s2), sum);
-    sum = vqaddq_s16(vqaddq_s16(s3, s4), sum);
-
-    int16x4x2_t sum2 = vuzp_s16(vget_high_s16(sum), vget_low_s16(sum));
-    int16x4_t sum3 = vpadd_s16(sum2.val[0], sum2.val[1]);
-    sum3 = vpadd_s16(sum3, sum3);
-
-    cint16_t result[2];
-    vst1_s16((int16_t*)&result, sum3);
-
-    return result[0];
-}
-#else
-static cint16_t dotprod_32(cint16_t *a, int16_t *b)
-{
-    cint16_t sum = { 0 };
-    int i;
-
-    for (i = 1; i < 16; i++)
+    if (q->idx + n > WINDOW_SIZE)
     {
-        sum.r += ((a[i].r + a[32-i].r) * b[i * 2]) >> 15;
-        sum.i += ((a[i].i + a[32-i].i) * b[i * 2]) >> 15;
+        slide(q);
+        if (q->idx + n > WINDOW_SIZE)
+            n = WINDOW_SIZE - q->idx;
     }
-    sum.r += (a[i].r * b[i * 2]) >> 15;
-    sum.i += (a[i].i * b[i * 2]) >> 15;
+    return n;
+}
 
-    return sum;
+// append up to 'n' samples to the window, returning how many fit
+static unsigned int push_block(firdecim_q15 q, const cint16_t *x, unsigned int n)
+{
+    n = reserve(q, n);
+    memcpy(&q->window[q->idx], x, n * sizeof(cint16_t));
+    return n;
+}
+
+void fir_q15_execute(firdecim_q15 q, const cint16_t *x, cint16_t *y)
+{
+    push(q, x[0]);
+    q->kernels->fir_block_32(&q->window[q->idx - q->ntaps], q->taps, y, 1);
 }
-#endif
 
-#ifdef HAVE_NEON
-static cint16_t dotprod_halfband_4(cint16_t *a, int16_t *b)
+void halfband_q15_execute(firdecim_q15 q, const cint16_t *x, cint16_t *y)
 {
-    cint16_t pairs[4];
-    int i;
+    push(q, x[0]);
+    q->kernels->halfband_block_4(&q->window[q->idx - q->ntaps], q->taps, y, 1);
+    push(q, x[1]);
+}
 
-    for (i = 0; i < 7; i += 2)
+void fir_q15_execute_block(firdecim_q15 q, const cint16_t *x, cint16_t *y, unsigned int n)
+{
+    while (n > 0)
     {
-        pairs[i/2].r = a[i].r + a[14-i].r;
-        pairs[i/2].i = a[i].i + a[14-i].i;
+        const unsigned int m = push_block(q, x, n);
+        q->kernels->fir_block_32(&q->window[q->idx + 1 - q->ntaps], q->taps, y, m);
+
+        q->idx += m;
+        x += m;
+        y += m;
+        n -= m;
     }
+}
 
-    int16x8_t prod = vqdmulhq_s16(vld1q_s16((int16_t *)pairs), vld1q_s16(b));
-    int16x4x2_t prod2 = vuzp_s16(vget_high_s16(prod), vget_low_s16(prod));
-    int16x4_t sum = vpadd_s16(prod2.val[0], prod2.val[1]);
-    sum = vpadd_s16(sum, sum);
+void halfband_q15_execute_block(firdecim_q15 q, const cint16_t *x, cint16_t *y, unsigned int n)
+{
+    while (n > 0)
+    {
+        const unsigned int m = push_block(q, x, n * 2) / 2;
+        q->kernels->halfband_block_4(&q->window[q->idx + 1 - q->ntaps], q->taps, y, m);
 
-    cint16_t result[2];
-    vst1_s16((int16_t*)&result, sum);
+        q->idx += m * 2;
+        x += m * 2;
+        y += m;
+        n -= m;
+    }
+}
 
-    result[0].r += a[7].r;
-    result[0].i += a[7].i;
-    return result[0];
+/*
+ * Same as halfband_q15_execute_block(), but with cu8 input. Samples are
+ * converted to (x - 127) << shift as they are copied into the window,
+ * instead of in a separate pass.
+ */
+void halfband_q15_execute_cu8(firdecim_q15 q, const uint8_t *x, cint16_t *y, unsigned int n, int shift)
+{
+    while (n > 0)
+    {
+        const unsigned int m = reserve(q, n * 2) / 2;
+        q->kernels->cu8_to_q15(x, &q->window[q->idx], m * 2, shift);
+        q->kernels->halfband_block_4(&q->window[q->idx + 1 - q->ntaps], q->taps, y, m);
+
+        q->idx += m * 2;
+        x += m * 4;
+        y += m;
+        n -= m;
+    }
 }
-#else
-static cint16_t dotprod_halfband_4(cint16_t *a, int16_t *b)
+
+/*
+ * Decimate 'n' samples by two, for any 'n'. An output only depends on the
+ * first sample of its pair, so it is produced as soon as that sample is
+ * pushed, and the second sample may arrive in the next call. Returns the
+ * number of outputs.
+ */
+unsigned int halfband_q15_decimate(firdecim_q15 q, const cint16_t *x, cint16_t *y, unsigned int n)
 {
-    cint16_t sum = { 0 };
-    int i;
+    unsigned int m;
 
-    for (i = 0; i < 7; i += 2)
+    if (q->odd && n > 0)
     {
-        sum.r += ((a[i].r + a[14-i].r) * b[i]) >> 15;
-        sum.i += ((a[i].i + a[14-i].i) * b[i]) >> 15;
+        push(q, x[0]);
+        q->odd = 0;
+        x++;
+        n--;
     }
-    sum.r += a[7].r;
-    sum.i += a[7].i;
 
-    return sum;
-}
-#endif
+    m = n / 2;
+    halfband_q15_execute_block(q, x, y, m);
 
-void fir_q15_execute(firdecim_q15 q, const cint16_t *x, cint16_t *y)
-{
-    push(q, x[0]);
-    *y = dotprod_32(&q->window[q->idx - q->ntaps], q->taps);
-}
+    if (n & 1)
+    {
+        push(q, x[m * 2]);
+        q->kernels->halfband_block_4(&q->window[q->idx - q->ntaps], q->taps, &y[m], 1);
+        q->odd = 1;
+        m++;
+    }
 
-void halfband_q15_execute(firdecim_q15 q, const cint16_t *x, cint16_t *y)
-{
-    push(q, x[0]);
-    *y = dotprod_halfband_4(&q->window[q->idx - q->ntaps], q->taps);
-    push(q, x[1]);
+    return m;
 }
@@ -9,3 +9,7 @@ void firdecim_q15_free(firdecim_q15);
 void firdecim_q15_reset(firdecim_q15);
 void fir_q15_execute(firdecim_q15 q, const cint16_t *x, cint16_t *y);
 void halfband_q15_execute(firdecim_q15 q, const cint16_t *x, cint16_t *y);
+void fir_q15_execute_block(firdecim_q15 q, const cint16_t *x, cint16_t *y, unsigned int n);
+void halfband_q15_execute_block(firdecim_q15 q, const cint16_t *x, cint16_t *y, unsigned int n);
+void halfband_q15_execute_cu8(firdecim_q15 q, const uint8_t *x, cint16_t *y, unsigned int n, int shift);
+unsigned int halfband_q15_decimate(firdecim_q15 q, const cint16_t *x, cint16_t *y, unsigned int n);
@@ -0,0 +1,10 @@
+#include "config.h"
+
+#include "firdecim_q15_kernels.h"
+#include "firdecim_q15_block.h"
+
+const firdecim_q15_kernels firdecim_q15_kernels_avx2 = {
+    fir_block_32,
+    halfband_block_4,
+    cu8_to_q15,
+};
@@ -0,0 +1,369 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(HAVE_AVX2)
+#include <immintrin.h>
+#elif defined(HAVE_SSE2)
+#include <emmintrin.h>
+#endif
+
+#include "defines.h"
+
+#define HALFBAND_BLOCK 256
+
+#ifdef HAVE_NEON
+static cint16_t dotprod_32(cint16_t *a, int16_t *b)
+{
+    int16x8_t s1 = vqdmulhq_s16(vld1q_s16((int16_t *)&a[0]), vld1q_s16(&b[0*2]));
+    int16x8_t s2 = vqdmulhq_s16(vld1q_s16((int16_t *)&a[4]), vld1q_s16(&b[4*2]));
+    int16x8_t s3 = vqdmulhq_s16(vld1q_s16((int16_t *)&a[8]), vld1q_s16(&b[8*2]));
+    int16x8_t s4 = vqdmulhq_s16(vld1q_s16((int16_t *)&a[12]), vld1q_s16(&b[12*2]));
+    int16x8_t sum = vqaddq_s16(vqaddq_s16(s1, s2), vqaddq_s16(s3, s4));
+
+    s1 = vqdmulhq_s16(vld1q_s16((int16_t *)&a[16]), vld1q_s16(&b[16*2]));
+    s2 = vqdmulhq_s16(vld1q_s16((int16_t *)&a[20]), vld1q_s16(&b[20*2]));
+    s3 = vqdmulhq_s16(vld1q_s16((int16_t *)&a[24]), vld1q_s16(&b[24*2]));
+    s4 = vqdmulhq_s16(vld1q_s16((int16_t *)&a[28]), vld1q_s16(&b[28*2]));
+    sum = vqaddq_s16(vqaddq_s16(s1, s2), sum);
+    sum = vqaddq_s16(vqaddq_s16(s3, s4), sum);
+
+    int16x4x2_t sum2 = vuzp_s16(vget_high_s16(sum), vget_low_s16(sum));
+    int16x4_t sum3 = vpadd_s16(sum2.val[0], sum2.val[1]);
+    sum3 = vpadd_s16(sum3, sum3);
+
+    cint16_t result[2];
+    vst1_s16((int16_t*)&result, sum3);
+
+    return result[0];
+}
+
+static cint16_t dotprod_halfband_4(cint16_t *a, int16_t *b)
+{
+    cint16_t pairs[4];
+    int i;
+
+    for (i = 0; i < 7; i += 2)
+    {
+        pairs[i/2].r = a[i].r + a[14-i].r;
+        pairs[i/2].i = a[i].i + a[14-i].i;
+    }
+
+    int16x8_t prod = vqdmulhq_s16(vld1q_s16((int16_t *)pairs), vld1q_s16(b));
+    int16x4x2_t prod2 = vuzp_s16(vget_high_s16(prod), vget_low_s16(prod));
+    int16x4_t sum = vpadd_s16(prod2.val[0], prod2.val[1]);
+    sum = vpadd_s16(sum, sum);
+
+    cint16_t result[2];
+    vst1_s16((int16_t*)&result, sum);
+
+    result[0].r += a[7].r;
+    result[0].i += a[7].i;
+    return result[0];
+}
+
+static void fir_block_32(cint16_t *w, int16_t *b, cint16_t *y, unsigned int m)
+{
+    for (unsigned int i = 0; i < m; i++)
+        y[i] = dotprod_32(&w[i], b);
+}
+
+static void halfband_block_4(cint16_t *w, int16_t *b, cint16_t *y, unsigned int m)
+{
+    for (unsigned int i = 0; i < m; i++)
+        y[i] = dotprod_halfband_4(&w[i * 2], b);
+}
+#else
+#if defined(HAVE_SSE2)
+/*
+ * Same arithmetic as the portable code below, so that every level gives
+ * the same output. Each tap multiplies the sum of its two symmetric
+ * samples, which may need 17 bits, so the samples are interleaved and madd
+ * computes lo * b + hi * b exactly in 32 bits. Each product is truncated
+ * by 15 bits on its own, and the sums only have to be right modulo 2^16,
+ * since the portable code wraps to int16.
+ */
+
+// tap b as a madd coefficient for both samples of an interleaved pair
+static inline int coef_both(int16_t b)
+{
+    return (int) (((uint32_t) (uint16_t) b << 16) | (uint16_t) b);
+}
+
+// tap b as a madd coefficient for the first sample of a pair only
+static inline int coef_first(int16_t b)
+{
+    return (uint16_t) b;
+}
+
+#ifdef HAVE_AVX2
+static inline __m256i wrap16_256(__m256i lo, __m256i hi)
+{
+    lo = _mm256_srai_epi32(_mm256_slli_epi32(lo, 16), 16);
+    hi = _mm256_srai_epi32(_mm256_slli_epi32(hi, 16), 16);
+    return _mm256_packs_epi32(lo, hi);
+}
+#endif
+
+// the low 16 bits of each 32-bit sum, in order
+static inline __m128i wrap16_128(__m128i lo, __m128i hi)
+{
+    lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+    hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+    return _mm_packs_epi32(lo, hi);
+}
+
+static void fir_block_32(cint16_t *w, int16_t *b, cint16_t *y, unsigned int m)
+{
+    const int16_t *in = (const int16_t *) w;
+    int16_t *out = (int16_t *) y;
+    unsigned int i = 0, k;
+
+#ifdef HAVE_AVX2
+    for (; i + 16 <= m * 2; i += 16)
+    {
+        // in-lane unpack and pack, so the outputs stay in order
+        __m256i x = _mm256_loadu_si256((const __m256i *) &in[i + 32]);
+        __m256i c = _mm256_set1_epi32(coef_first(b[32]));
+        __m256i lo = _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(x, _mm256_setzero_si256()), c), 15);
+        __m256i hi = _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(x, _mm256_setzero_si256()), c), 15);
+
+        for (k = 1; k < 16; k++)
+        {
+            __m256i x0 = _mm256_loadu_si256((const __m256i *) &in[i + k * 2]);
+            __m256i x1 = _mm256_loadu_si256((const __m256i *) &in[i + (32 - k) * 2]);
+            c = _mm256_set1_epi32(coef_both(b[k * 2]));
+
+            lo = _mm256_add_epi32(lo, _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(x0, x1), c), 15));
+            hi = _mm256_add_epi32(hi, _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(x0, x1), c), 15));
+        }
+
+        _mm256_storeu_si256((__m256i *) &out[i], wrap16_256(lo, hi));
+    }
+#endif
+
+    for (; i + 8 <= m * 2; i += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *) &in[i + 32]);
+        __m128i c = _mm_set1_epi32(coef_first(b[32]));
+        __m128i lo = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(x, _mm_setzero_si128()), c), 15);
+        __m128i hi = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(x, _mm_setzero_si128()), c), 15);
+
+        for (k = 1; k < 16; k++)
+        {
+            __m128i x0 = _mm_loadu_si128((const __m128i *) &in[i + k * 2]);
+            __m128i x1 = _mm_loadu_si128((const __m128i *) &in[i + (32 - k) * 2]);
+            c = _mm_set1_epi32(coef_both(b[k * 2]));
+
+            lo = _mm_add_epi32(lo, _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(x0, x1), c), 15));
+            hi = _mm_add_epi32(hi, _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(x0, x1), c), 15));
+        }
+
+        _mm_storeu_si128((__m128i *) &out[i], wrap16_128(lo, hi));
+    }
+
+    for (; i < m * 2; i++)
+    {
+        int16_t sum = (in[i + 32] * b[32]) >> 15;
+
+        for (k = 1; k < 16; k++)
+            sum += ((in[i + k * 2] + in[i + (32 - k) * 2]) * b[k * 2]) >> 15;
+        out[i] = sum;
+    }
+}
+
+// add the four folded taps of the halfband filter to the center samples in 'out'
+static void halfband_taps(const int16_t *even, const int16_t *b, int16_t *out, unsigned int len)
+{
+    unsigned int i = 0, k;
+
+#ifdef HAVE_AVX2
+    for (; i + 16 <= len; i += 16)
+    {
+        __m256i lo = _mm256_setzero_si256();
+        __m256i hi = _mm256_setzero_si256();
+
+        for (k = 0; k < 4; k++)
+        {
+            __m256i x0 = _mm256_loadu_si256((const __m256i *) &even[i + k * 2]);
+            __m256i x1 = _mm256_loadu_si256((const __m256i *) &even[i + (7 - k) * 2]);
+            __m256i c = _mm256_set1_epi32(coef_both(b[k * 2]));
+
+            lo = _mm256_add_epi32(lo, _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(x0, x1), c), 15));
+            hi = _mm256_add_epi32(hi, _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(x0, x1), c), 15));
+        }
+
+        _mm256_storeu_si256((__m256i *) &out[i],
+                            _mm256_add_epi16(_mm256_loadu_si256((const __m256i *) &out[i]), wrap16_256(lo, hi)));
+    }
+#endif
+
+    for (; i + 8 <= len; i += 8)
+    {
+        __m128i lo = _mm_setzero_si128();
+        __m128i hi = _mm_setzero_si128();
+
+        for (k = 0; k < 4; k++)
+        {
+            __m128i x0 = _mm_loadu_si128((const __m128i *) &even[i + k * 2]);
+            __m128i x1 = _mm_loadu_si128((const __m128i *) &even[i + (7 - k) * 2]);
+            __m128i c = _mm_set1_epi32(coef_both(b[k * 2]));
+
+            lo = _mm_add_epi32(lo, _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(x0, x1), c), 15));
+            hi = _mm_add_epi32(hi, _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(x0, x1), c), 15));
+        }
+
+        _mm_storeu_si128((__m128i *) &out[i],
+                         _mm_add_epi16(_mm_loadu_si128((const __m128i *) &out[i]), wrap16_128(lo, hi)));
+    }
+
+    for (; i < len; i++)
+    {
+        for (k = 0; k < 4; k++)
+            out[i] += ((even[i + k * 2] + even[i + (7 - k) * 2]) * b[k * 2]) >> 15;
+    }
+}
+#else
+/*
+ * Taps are in the outer loop so that the inner loop runs over the real and
+ * imaginary parts of all outputs and can be vectorized. Each product is
+ * truncated on its own, and int16 wraparound does not depend on the order
+ * of the additions.
+ */
+static void fir_block_32(cint16_t *w, int16_t *b, cint16_t *y, unsigned int m)
+{
+    const int16_t *in = (const int16_t *) w;
+    int16_t *out = (int16_t *) y;
+    unsigned int i, k;
+
+    for (i = 0; i < m * 2; i++)
+        out[i] = (in[i + 32] * b[32]) >> 15;
+
+    for (k = 1; k < 16; k++)
+    {
+        const int16_t *lo = &in[k * 2];
+        const int16_t *hi = &in[(32 - k) * 2];
+
+        for (i = 0; i < m * 2; i++)
+            out[i] += ((lo[i] + hi[i]) * b[k * 2]) >> 15;
+    }
+}
+
+// add the four folded taps of the halfband filter to the center samples in 'out'
+static void halfband_taps(const int16_t *even, const int16_t *b, int16_t *out, unsigned int len)
+{
+    unsigned int i, k;
+
+    for (k = 0; k < 4; k++)
+    {
+        const int16_t *lo = &even[k * 2];
+        const int16_t *hi = &even[(7 - k) * 2];
+
+        for (i = 0; i < len; i++)
+            out[i] += ((lo[i] + hi[i]) * b[k * 2]) >> 15;
+    }
+}
+#endif
+
+/*
+ * The non-zero halfband taps only touch even input samples, and the center
+ * tap is one odd sample, so split the window into even and odd samples to
+ * get unit-stride loops over the outputs.
+ */
+static void halfband_block_4(cint16_t *w, int16_t *b, cint16_t *y, unsigned int m)
+{
+    int16_t even[(HALFBAND_BLOCK + 7) * 2];
+    int16_t *out = (int16_t *) y;
+    unsigned int i, j, n;
+
+    for (j = 0; j < m; j += n, w += n * 2, out += n * 2)
+    {
+        n = (m - j > HALFBAND_BLOCK) ? HALFBAND_BLOCK : m - j;
+
+        for (i = 0; i < n + 7; i++)
+        {
+            even[i * 2] = w[i * 2].r;
+            even[i * 2 + 1] = w[i * 2].i;
+        }
+
+        for (i = 0; i < n; i++)
+        {
+            out[i * 2] = w[i * 2 + 7].r;
+            out[i * 2 + 1] = w[i * 2 + 7].i;
+        }
+
+        halfband_taps(even, b, out, n * 2);
+    }
+}
+#endif
+
+#if defined(HAVE_NEON)
+static void cu8_to_q15(const uint8_t *x, cint16_t *y, unsigned int m, int shift)
+{
+    const int16x8_t bias = vdupq_n_s16(127);
+    const int16x8_t count = vdupq_n_s16(shift);
+    int16_t *out = (int16_t *) y;
+    unsigned int i = 0;
+
+    for (; i + 16 <= m * 2; i += 16)
+    {
+        uint8x16_t v = vld1q_u8(&x[i]);
+        int16x8_t lo = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(v)));
+        int16x8_t hi = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(v)));
+
+        vst1q_s16(&out[i], vshlq_s16(vsubq_s16(lo, bias), count));
+        vst1q_s16(&out[i + 8], vshlq_s16(vsubq_s16(hi, bias), count));
+    }
+
+    for (; i < m * 2; i++)
+        out[i] = (x[i] - 127) * (1 << shift);
+}
+#elif defined(HAVE_SSE2)
+static void cu8_to_q15(const uint8_t *x, cint16_t *y, unsigned int m, int shift)
+{
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    int16_t *out = (int16_t *) y;
+    unsigned int i = 0;
+
+#ifdef HAVE_AVX2
+    const __m256i bias_256 = _mm256_set1_epi16(127);
+
+    for (; i + 32 <= m * 2; i += 32)
+    {
+        __m256i lo = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &x[i]));
+        __m256i hi = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &x[i + 16]));
+
+        _mm256_storeu_si256((__m256i *) &out[i], _mm256_sll_epi16(_mm256_sub_epi16(lo, bias_256), count));
+        _mm256_storeu_si256((__m256i *) &out[i + 16], _mm256_sll_epi16(_mm256_sub_epi16(hi, bias_256), count));
+    }
+#endif
+
+    const __m128i bias = _mm_set1_epi16(127);
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; i + 16 <= m * 2; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *) &x[i]);
+        __m128i lo = _mm_unpacklo_epi8(v, zero);
+        __m128i hi = _mm_unpackhi_epi8(v, zero);
+
+        _mm_storeu_si128((__m128i *) &out[i], _mm_sll_epi16(_mm_sub_epi16(lo, bias), count));
+        _mm_storeu_si128((__m128i *) &out[i + 8], _mm_sll_epi16(_mm_sub_epi16(hi, bias), count));
+    }
+
+    for (; i < m * 2; i++)
+        out[i] = (x[i] - 127) * (1 << shift);
+}
+#else
+static void cu8_to_q15(const uint8_t *x, cint16_t *y, unsigned int m, int shift)
+{
+    int16_t *out = (int16_t *) y;
+
+    for (unsigned int i = 0; i < m * 2; i++)
+        out[i] = (x[i] - 127) * (1 << shift);
+}
+#endif
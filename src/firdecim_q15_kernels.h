@@ -0,0 +1,22 @@
+#pragma once
+
+#include "defines.h"
+
+/*
+ * Block kernels of one SIMD level. Each level is built in its own file,
+ * firdecim_q15_*.c, with the compiler flags of that level. The filter
+ * kernels compute 'm' outputs 'y' from the window 'w' and the reversed
+ * taps 'b'. The conversion kernel turns 'm' complex cu8 samples 'x' into
+ * (x - 127) << shift, which is U8_Q15() for a shift of 6.
+ */
+typedef struct
+{
+    void (*fir_block_32)(cint16_t *w, int16_t *b, cint16_t *y, unsigned int m);
+    void (*halfband_block_4)(cint16_t *w, int16_t *b, cint16_t *y, unsigned int m);
+    void (*cu8_to_q15)(const uint8_t *x, cint16_t *y, unsigned int m, int shift);
+} firdecim_q15_kernels;
+
+extern const firdecim_q15_kernels firdecim_q15_kernels_gen;
+extern const firdecim_q15_kernels firdecim_q15_kernels_sse2;
+extern const firdecim_q15_kernels firdecim_q15_kernels_avx2;
+extern const firdecim_q15_kernels firdecim_q15_kernels_neon;
@@ -157,24 +157,22 @@ static int has_fixed(frame_t *st)
 
 static int fix_header(frame_t *st, uint8_t *buf)
 {
-    uint8_t hdr[RS_BLOCK_LEN];
+    uint8_t hdr[RS_CODEWORD_LEN];
     int i, corrections;
 
-    memset(hdr, 0, RS_BLOCK_LEN-RS_CODEWORD_LEN);
     for (i = 0; i < RS_CODEWORD_LEN; i++)
-        hdr[RS_BLOCK_LEN-i-1] = buf[i];
+        hdr[RS_CODEWORD_LEN-i-1] = buf[i];
 
     corrections = decode_rs_char(st->rs_dec, hdr, NULL, 0);
 
     if (corrections == -1)
         return 0;
 
-    for (i = 0; i < RS_BLOCK_LEN-RS_CODEWORD_LEN; i++)
-        if (hdr[i] != 0)
-            return 0;
-
-    for (i = 0; i < RS_CODEWORD_LEN; i++)
-        buf[i] = hdr[RS_BLOCK_LEN-i-1];
+    if (corrections > 0)
+    {
+        for (i = 0; i < RS_CODEWORD_LEN; i++)
+            buf[i] = hdr[RS_CODEWORD_LEN-i-1];
+    }
     return 1;
 }
 
@@ -536,7 +534,7 @@ void frame_process(frame_t *st, size_t length, logical_channel_t lc)
         {
             // go back to coarse sync if we fail to decode any audio packets in a P1 frame
             if ((length == MAX_PDU_LEN || length == P1_PDU_LEN_AM) && offset == 0)
-                input_set_sync_state(st->input, SYNC_STATE_NONE);
+                decode_lost_sync(&st->input->decode);
             return;
         }
 
@@ -744,7 +742,7 @@ void frame_reset(frame_t *st)
 void frame_init(frame_t *st, input_t *input)
 {
     st->input = input;
-    st->rs_dec = init_rs_char(8, 0x11d, 1, 1, 8);
+    st->rs_dec = init_rs_char(8, 0x11d, 1, 1, 8, RS_BLOCK_LEN - RS_CODEWORD_LEN);
     frame_reset(st);
 }
 
@@ -49,48 +49,30 @@ void input_push(input_t *st, const cint16_t* buf, const uint32_t len)
     }
 }
 
+/*
+ * FM input is decimated by 2 and AM input by 32, with a cascade of
+ * halfband filters. AM input is scaled down by 16 to leave headroom for
+ * the cascade. Each stage filters the whole buffer before the next one.
+ */
 unsigned int decimate_samples(input_t *st, const uint8_t* in, const uint32_t len, cint16_t *out)
 {
-    unsigned int avail = 0;
+    cint16_t buf[2][AM_DECIM_BLOCK_LEN];
+    unsigned int n;
 
-    for (uint32_t i = 0; i < len; i += 4)
+    if (st->radio->mode == NRSC5_MODE_FM)
     {
-        cint16_t x[2];
-
-        x[0].r = U8_Q15(in[i]);
-        x[0].i = U8_Q15(in[i + 1]);
-        x[1].r = U8_Q15(in[i + 2]);
-        x[1].i = U8_Q15(in[i + 3]);
-
-        if (st->radio->mode == NRSC5_MODE_FM)
-        {
-            halfband_q15_execute(st->decim[0], x, &out[avail++]);
-        }
-        else
-        {
-            x[0].r >>= 4;
-            x[0].i >>= 4;
-            x[1].r >>= 4;
-            x[1].i >>= 4;
-
-            halfband_q15_execute(st->decim[0], x, &st->stages[0][st->offset & 1]);
-            if ((st->offset & 0x1) == 0x1) {
-                halfband_q15_execute(st->decim[1], st->stages[0], &st->stages[1][(st->offset >> 1) & 1]);
-            }
-            if ((st->offset & 0x3) == 0x3) {
-                halfband_q15_execute(st->decim[2], st->stages[1], &st->stages[2][(st->offset >> 2) & 1]);
-            }
-            if ((st->offset & 0x7) == 0x7) {
-                halfband_q15_execute(st->decim[3], st->stages[2], &st->stages[3][(st->offset >> 3) & 1]);
-            }
-            if ((st->offset & 0xf) == 0xf) {
-                halfband_q15_execute(st->decim[4], st->stages[3], &out[avail++]);
-            }
-            st->offset++;
-        }
+        halfband_q15_execute_cu8(st->decim[0], in, out, len / 4, 6);
+        return len / 4;
     }
 
-    return avail;
+    assert(len / 4 <= AM_DECIM_BLOCK_LEN);
+
+    n = len / 4;
+    halfband_q15_execute_cu8(st->decim[0], in, buf[0], n, 2);
+    n = halfband_q15_decimate(st->decim[1], buf[0], buf[1], n);
+    n = halfband_q15_decimate(st->decim[2], buf[1], buf[0], n);
+    n = halfband_q15_decimate(st->decim[3], buf[0], buf[1], n);
+    return halfband_q15_decimate(st->decim[4], buf[1], out, n);
 }
 
 void input_push_cu8(input_t *st, const uint8_t *buf, const uint32_t len)
@@ -125,7 +107,6 @@ void input_push_cs16(input_t *st, const int16_t *buf, const uint32_t len)
 
 void input_reset(input_t *st)
 {
-    st->offset = 0;
     st->resample_input_size = st->radio->mode == NRSC5_MODE_FM ? (FFTCP_FM * 2) : (FFTCP_AM * 32);
 
     input_set_sync_state(st, SYNC_STATE_NONE);
@@ -133,7 +114,6 @@ void input_reset(input_t *st)
         firdecim_q15_reset(st->decim[i]);
     acquire_reset(&st->acq);
     decode_reset(&st->decode);
-    frame_reset(&st->frame);
     sync_reset(&st->sync);
 }
 
@@ -163,12 +143,28 @@ void input_set_mode(input_t *st)
 void input_free(input_t *st)
 {
     acquire_free(&st->acq);
+    decode_free(&st->decode);
     frame_free(&st->frame);
 
     for (int i = 0; i < AM_DECIM_STAGES; i++)
         firdecim_q15_free(st->decim[i]);
 }
 
+void input_set_ber_interval(input_t *st, unsigned int interval)
+{
+    decode_set_ber_interval(&st->decode, interval);
+}
+
+void input_flush(input_t *st)
+{
+    decode_flush(&st->decode);
+}
+
+int input_set_fec_threads(input_t *st, int threads)
+{
+    return decode_set_fec_threads(&st->decode, threads);
+}
+
 void input_set_sync_state(input_t *st, unsigned int new_state)
 {
     if (st->sync_state == new_state)
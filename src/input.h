@@ -14,6 +14,8 @@
 #include "sync.h"
 
 #define AM_DECIM_STAGES 5
+// first stage outputs per call to decimate_samples() in AM mode
+#define AM_DECIM_BLOCK_LEN (FFTCP_AM * 8)
 
 enum { SYNC_STATE_NONE, SYNC_STATE_COARSE, SYNC_STATE_FINE };
 
@@ -23,9 +25,7 @@ typedef struct input_t
     output_t *output;
 
     firdecim_q15 decim[AM_DECIM_STAGES];
-    cint16_t stages[AM_DECIM_STAGES][2];
     unsigned int resample_input_size;
-    unsigned int offset;
     unsigned int sync_state;
 
     acquire_t acq;
@@ -38,6 +38,9 @@ void input_init(input_t *st, nrsc5_t *radio, output_t *output);
 void input_set_mode(input_t *st);
 void input_reset(input_t *st);
 void input_free(input_t *st);
+void input_set_ber_interval(input_t *st, unsigned int interval);
+void input_flush(input_t *st);
+int input_set_fec_threads(input_t *st, int threads);
 void input_set_sync_state(input_t *st, unsigned int new_state);
 void input_push_cu8(input_t *st, const uint8_t *buf, uint32_t len);
 void input_push_cs16(input_t *st, const int16_t *buf, uint32_t len);
@@ -72,6 +72,7 @@ typedef struct {
     FILE *iq_file;
     char *aas_files_path;
     enum iq_format iq_input_format;
+    int fec_threads;
 
     audio_buffer_t *head, *tail, *free;
     pthread_mutex_t mutex;
@@ -792,7 +793,7 @@ static void *input_main(void *arg)
 
 static void help(const char *progname)
 {
-    fprintf(stderr, "Usage: %s [-v] [-q] [--am] [-l log-level] [-d device-index] [-H rtltcp-host] [-p ppm-error] [-g gain] [-r iq-input] [--iq-input-format {cu8,cs16}] [-w iq-output] [-o audio-output] [-t audio-type] [-T] [-D direct-sampling-mode] [--dump-hdc hdc-output] [--dump-aas-files directory] frequency program\n", progname);
+    fprintf(stderr, "Usage: %s [-v] [-q] [--am] [-l log-level] [-d device-index] [-H rtltcp-host] [-p ppm-error] [-g gain] [-r iq-input] [--iq-input-format {cu8,cs16}] [-w iq-output] [-o audio-output] [-t audio-type] [-T] [-D direct-sampling-mode] [--dump-hdc hdc-output] [--dump-aas-files directory] [--fec-threads threads] [--fftw-wisdom file] frequency program\n", progname);
 }
 
 static int parse_args(state_t *st, int argc, char *argv[])
@@ -802,6 +803,8 @@ static int parse_args(state_t *st, int argc, char *argv[])
         { "dump-hdc", required_argument, NULL, 2 },
         { "am", no_argument, NULL, 3 },
         { "iq-input-format", required_argument, NULL, 4 },
+        { "fec-threads", required_argument, NULL, 5 },
+        { "fftw-wisdom", required_argument, NULL, 6 },
         { 0 }
     };
     const char *version = NULL;
@@ -816,6 +819,7 @@ static int parse_args(state_t *st, int argc, char *argv[])
     st->direct_sampling = -1;
     st->ppm_error = INT_MIN;
     st->iq_input_format = IQ_FORMAT_CU8;
+    st->fec_threads = 1;
     log_set_level(LOG_INFO);
 
     while ((opt = getopt_long(argc, argv, "r:w:o:t:d:p:g:ql:vH:TD:", long_opts, NULL)) != -1)
@@ -846,6 +850,18 @@ static int parse_args(state_t *st, int argc, char *argv[])
                 return -1;
             }
             break;
+        case 5:
+            st->fec_threads = strtol(optarg, &endptr, 10);
+            if (*endptr != 0 || st->fec_threads < 1)
+            {
+                log_fatal("Invalid number of FEC threads.");
+                return -1;
+            }
+            break;
+        case 6:
+            if (nrsc5_set_fftw_wisdom_file(optarg) != 0)
+                log_warn("Unable to load FFTW wisdom.");
+            break;
         case 'r':
             st->input_name = strdup(optarg);
             break;
@@ -1084,6 +1100,11 @@ int main(int argc, char *argv[])
         return 1;
     }
     nrsc5_set_mode(radio, st->mode);
+    if (nrsc5_set_fec_threads(radio, st->fec_threads) != 0)
+    {
+        log_fatal("Set FEC threads failed.");
+        return 1;
+    }
     if (st->gain >= 0.0f)
         nrsc5_set_gain(radio, st->gain);
     nrsc5_set_callback(radio, callback, st);
@@ -4,6 +4,7 @@
 #include "private.h"
 
 pthread_mutex_t fftw_mutex = PTHREAD_MUTEX_INITIALIZER;
+char *fftw_wisdom_file = NULL;
 
 static int get_tuner_gains(nrsc5_t *st, int *gains)
 {
@@ -216,6 +217,7 @@ static void nrsc5_init(nrsc5_t *st)
     st->freq = NRSC5_SCAN_BEGIN;
     st->mode = NRSC5_MODE_FM;
     st->callback = NULL;
+    pthread_mutex_init(&st->report_mutex, NULL);
 
     output_init(&st->output, st);
     input_init(&st->input, st, &st->output);
@@ -322,6 +324,27 @@ void nrsc5_alert_category_name(unsigned int type, const char **name)
     }
 }
 
+int nrsc5_set_fftw_wisdom_file(const char *path)
+{
+    int ret = 0;
+    FILE *fp;
+
+    pthread_mutex_lock(&fftw_mutex);
+    free(fftw_wisdom_file);
+    fftw_wisdom_file = path ? strdup(path) : NULL;
+
+    // a missing file is not an error, as it will be created after planning
+    if (path && (fp = fopen(path, "r")) != NULL)
+    {
+        fclose(fp);
+        if (!fftwf_import_wisdom_from_filename(path))
+            ret = 1;
+    }
+    pthread_mutex_unlock(&fftw_mutex);
+
+    return ret;
+}
+
 static nrsc5_t *nrsc5_alloc(void)
 {
     nrsc5_t *st = calloc(1, sizeof(*st));
@@ -428,6 +451,7 @@ void nrsc5_close(nrsc5_t *st)
 
     input_free(&st->input);
     output_free(&st->output);
+    pthread_mutex_destroy(&st->report_mutex);
     free(st);
 }
 
@@ -459,10 +483,15 @@ void nrsc5_stop(nrsc5_t *st)
             pthread_cond_wait(&st->worker_cond, &st->worker_mutex);
         pthread_mutex_unlock(&st->worker_mutex);
     }
+
+    // wait for the FEC thread to decode everything demodulated so far
+    input_flush(&st->input);
 }
 
 int nrsc5_set_mode(nrsc5_t *st, int mode)
 {
+    if (!st->stopped)
+        return 1;
     if (mode == NRSC5_MODE_FM || mode == NRSC5_MODE_AM)
     {
         st->mode = mode;
@@ -472,6 +501,21 @@ int nrsc5_set_mode(nrsc5_t *st, int mode)
     return 1;
 }
 
+int nrsc5_set_fec_threads(nrsc5_t *st, int threads)
+{
+    if (threads < 1 || !st->stopped)
+        return 1;
+    if (input_set_fec_threads(&st->input, threads) != 0)
+        return 1;
+    return 0;
+}
+
+int nrsc5_set_ber_interval(nrsc5_t *st, unsigned int interval)
+{
+    input_set_ber_interval(&st->input, interval);
+    return 0;
+}
+
 int nrsc5_set_bias_tee(nrsc5_t *st, int on)
 {
     if (st->dev)
@@ -546,6 +590,7 @@ int nrsc5_set_frequency(nrsc5_t *st, float freq)
     if (st->auto_gain)
         st->gain = -1;
     input_reset(&st->input);
+    input_flush(&st->input);
     output_reset(&st->output);
 
     st->freq = freq;
@@ -651,8 +696,11 @@ int nrsc5_pipe_samples_cs16(nrsc5_t *st, const int16_t *samples, unsigned int le
 
 void nrsc5_report(nrsc5_t *st, const nrsc5_event_t *evt)
 {
+    // events come from both the demodulator and the FEC thread
+    pthread_mutex_lock(&st->report_mutex);
     if (st->callback)
         st->callback(evt, st->callback_opaque);
+    pthread_mutex_unlock(&st->report_mutex);
 }
 
 void nrsc5_report_lost_device(nrsc5_t *st)
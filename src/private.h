@@ -13,6 +13,7 @@
 #include "rtltcp.h"
 
 extern pthread_mutex_t fftw_mutex;
+extern char *fftw_wisdom_file;
 
 struct nrsc5_t
 {
@@ -39,6 +40,7 @@ struct nrsc5_t
     pthread_t worker;
     pthread_mutex_t worker_mutex;
     pthread_cond_t worker_cond;
+    pthread_mutex_t report_mutex;
 
     input_t input;
     output_t output;
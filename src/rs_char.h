@@ -18,6 +18,8 @@ struct rs {
   unsigned char prim;       /* Primitive element, index form */
   unsigned char iprim;      /* prim-th root of 1, index form */
   int *modnn_table;         /* modnn lookup table, 512 entries */
+  unsigned int pad;         /* Padding symbols of a shortened code */
+  unsigned char *syn_table; /* Syndrome multiply tables, nroots x (nn+1) */
 };
 
 static inline unsigned int modnn(struct rs *rs, unsigned int x){
@@ -38,6 +40,8 @@ static inline unsigned int modnn(struct rs *rs, unsigned int x){
 #define FCR (rs->fcr)
 #define PRIM (rs->prim)
 #define IPRIM (rs->iprim)
+#define PAD (rs->pad)
+#define SYN_TABLE (rs->syn_table)
 #define A0 (NN)
 
 #define ENCODE_RS encode_rs_char
@@ -48,5 +52,5 @@ static inline unsigned int modnn(struct rs *rs, unsigned int x){
 void ENCODE_RS(void *p,DTYPE *data,DTYPE *parity);
 int DECODE_RS(void *p,DTYPE *data,int *eras_pos,int no_eras);
 void *INIT_RS(unsigned int symsize,unsigned int gfpoly,unsigned int fcr,
-		   unsigned int prim,unsigned int nroots);
+		   unsigned int prim,unsigned int nroots,unsigned int pad);
 void FREE_RS(void *p);
@@ -27,17 +27,19 @@ DTYPE *data, int *eras_pos, int no_eras){
   DTYPE root[NROOTS], reg[NROOTS+1], loc[NROOTS];
   int syn_error, count;
 
-  /* form the syndromes; i.e., evaluate data(x) at roots of g(x) */
-  for(i=0;(unsigned int)i<NROOTS;i++)
-    s[i] = data[0];
-
-  for(j=1;(unsigned int)j<NN;j++){
-    for(i=0;(unsigned int)i<NROOTS;i++){
-      if(s[i] == 0){
-	s[i] = data[j];
-      } else {
-	s[i] = data[j] ^ ALPHA_TO[MODNN(INDEX_OF[s[i]] + (FCR+i)*PRIM)];
-      }
+  /* form the syndromes; i.e., evaluate data(x) at roots of g(x)
+   * The padding of a shortened code is zero and does not contribute.
+   */
+  {
+    const DTYPE *syn = SYN_TABLE;
+    const int len = NN-PAD, nroots = NROOTS, mm = MM;
+
+    for(i=0;i<nroots;i++)
+      s[i] = data[0];
+
+    for(j=1;j<len;j++){
+      for(i=0;i<nroots;i++)
+	s[i] = data[j] ^ syn[(i<<mm) + s[i]];
     }
   }
 
@@ -60,9 +62,9 @@ DTYPE *data, int *eras_pos, int no_eras){
 
   if (no_eras > 0) {
     /* Init lambda to be the erasure locator polynomial */
-    lambda[1] = ALPHA_TO[MODNN(PRIM*(NN-1-eras_pos[0]))];
+    lambda[1] = ALPHA_TO[MODNN(PRIM*(NN-1-(eras_pos[0]+PAD)))];
     for (i = 1; i < no_eras; i++) {
-      u = MODNN(PRIM*(NN-1-eras_pos[i]));
+      u = MODNN(PRIM*(NN-1-(eras_pos[i]+PAD)));
       for (j = i+1; j > 0; j--) {
 	tmp = INDEX_OF[lambda[j - 1]];
 	if(tmp != A0)
@@ -126,15 +128,20 @@ DTYPE *data, int *eras_pos, int no_eras){
     if(lambda[i] != A0)
       deg_lambda = i;
   }
-  /* Find roots of the error+erasure locator polynomial by Chien search */
-  memcpy(&reg[1],&lambda[1],NROOTS*sizeof(reg[0]));
+  /* Find roots of the error+erasure locator polynomial by Chien search
+   * over the unpadded locations k, where the root is @**((k+1)*PRIM).
+   * Roots in the padding are not found and make the error uncorrectable.
+   */
+  r = MODNN((PAD+1)*PRIM);
+  for (j = 1; j <= deg_lambda; j++)
+    reg[j] = (lambda[j] == A0) ? A0 : MODNN(lambda[j] + j*r);
   count = 0;		/* Number of roots of lambda(x) */
-  for (i = 1,k=IPRIM-1; (unsigned int)i <= NN; i++,k = MODNN(k+IPRIM)) {
+  for (i = r,k=PAD; (unsigned int)k < NN; i = MODNN(i+PRIM),k++) {
     q = 1; /* lambda[0] is always 0 */
     for (j = deg_lambda; j > 0; j--){
       if (reg[j] != A0) {
-	reg[j] = MODNN(reg[j] + j);
 	q ^= ALPHA_TO[reg[j]];
+	reg[j] = MODNN(reg[j] + j*PRIM);
       }
     }
     if (q != 0)
@@ -198,13 +205,13 @@ DTYPE *data, int *eras_pos, int no_eras){
     }
     /* Apply error to data */
     if (num1 != 0) {
-      data[loc[j]] ^= ALPHA_TO[MODNN(INDEX_OF[num1] + INDEX_OF[num2] + NN - INDEX_OF[den])];
+      data[loc[j]-PAD] ^= ALPHA_TO[MODNN(INDEX_OF[num1] + INDEX_OF[num2] + NN - INDEX_OF[den])];
     }
   }
  finish:
   if(eras_pos != NULL){
     for(i=0;i<count;i++)
-      eras_pos[i] = loc[i];
+      eras_pos[i] = loc[i]-PAD;
   }
   return count;
 }
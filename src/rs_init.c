@@ -18,6 +18,7 @@ void FREE_RS(void *p){
   free(rs->index_of);
   free(rs->genpoly);
   free(rs->modnn_table);
+  free(rs->syn_table);
   free(rs);
 }
 
@@ -27,9 +28,10 @@ void FREE_RS(void *p){
  * fcr = first root of RS code generator polynomial, index form
  * prim = primitive element to generate polynomial roots
  * nroots = RS code generator polynomial degree (number of roots)
+ * pad = padding symbols before the data of a shortened code
  */
 void *INIT_RS(unsigned int symsize,unsigned int gfpoly,unsigned fcr,unsigned prim,
-		unsigned int nroots){
+		unsigned int nroots,unsigned int pad){
   struct rs *rs;
   int sr,root,iprim;
   unsigned int i, j;
@@ -43,10 +45,13 @@ void *INIT_RS(unsigned int symsize,unsigned int gfpoly,unsigned fcr,unsigned pri
     return NULL;
   if(nroots >= (1u<<symsize))
     return NULL; /* Can't have more roots than symbol values! */
+  if(pad >= ((1u<<symsize) -1 - nroots))
+    return NULL; /* Too much padding */
 
   rs = (struct rs *)calloc(1,sizeof(struct rs));
   rs->mm = symsize;
   rs->nn = (1<<symsize)-1;
+  rs->pad = pad;
 
   rs->alpha_to = (DTYPE *)malloc(sizeof(DTYPE)*(rs->nn+1));
   if(rs->alpha_to == NULL){
@@ -129,5 +134,21 @@ void *INIT_RS(unsigned int symsize,unsigned int gfpoly,unsigned fcr,unsigned pri
     rs->modnn_table[i] = modnn(rs,j);
   }
 
+  /* Form syndrome tables, multiplying each symbol by each root of g(x) */
+  rs->syn_table = (DTYPE *)malloc(sizeof(DTYPE)*(nroots<<symsize));
+  if(rs->syn_table == NULL){
+    free(rs->modnn_table);
+    free(rs->genpoly);
+    free(rs->alpha_to);
+    free(rs->index_of);
+    free(rs);
+    return NULL;
+  }
+  for(i = 0; i < nroots; i++){
+    rs->syn_table[i<<symsize] = 0;
+    for(j = 1; j <= rs->nn; j++)
+      rs->syn_table[(i<<symsize) + j] = rs->alpha_to[modnn(rs,rs->index_of[j] + (fcr+i)*prim)];
+  }
+
   return rs;
 }
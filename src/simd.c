@@ -0,0 +1,95 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "defines.h"
+#include "simd.h"
+
+static pthread_once_t simd_once = PTHREAD_ONCE_INIT;
+static int simd_selected;
+
+static const char *const simd_names[] = {
+    [SIMD_GENERIC] = "generic",
+    [SIMD_SSE3] = "sse3",
+    [SIMD_SSE41] = "sse4.1",
+    [SIMD_AVX2] = "avx2",
+    [SIMD_AVX512] = "avx512",
+    [SIMD_NEON] = "neon",
+};
+
+// whether the kernels of 'level' were built and can run on this CPU
+static int simd_supported(int level)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_cpu_init();
+#endif
+
+    switch (level)
+    {
+    case SIMD_GENERIC:
+        return 1;
+#ifdef USE_SSE
+    case SIMD_SSE3:
+        return __builtin_cpu_supports("ssse3");
+    case SIMD_SSE41:
+        return __builtin_cpu_supports("sse4.1");
+#endif
+#ifdef USE_AVX2
+    case SIMD_AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+#ifdef USE_AVX512
+    case SIMD_AVX512:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+#ifdef USE_NEON
+    case SIMD_NEON:
+        // the whole library is built for NEON
+        return 1;
+#endif
+    default:
+        return 0;
+    }
+}
+
+static void simd_init(void)
+{
+    const char *name = getenv("NRSC5_SIMD");
+    int level;
+
+    for (level = SIMD_NEON; level > SIMD_GENERIC; level--)
+    {
+        if (simd_supported(level))
+            break;
+    }
+    simd_selected = level;
+
+    if (name != NULL && name[0] != '\0')
+    {
+        for (level = SIMD_GENERIC; level <= SIMD_NEON; level++)
+        {
+            if (strcmp(name, simd_names[level]) == 0)
+                break;
+        }
+
+        if (level > SIMD_NEON)
+            log_warn("Unknown NRSC5_SIMD level: %s", name);
+        else if (!simd_supported(level))
+            log_warn("NRSC5_SIMD level %s is not available", name);
+        else
+            simd_selected = level;
+    }
+
+    log_info("Using %s kernels", simd_names[simd_selected]);
+}
+
+/*
+ * Return the SIMD level to use: the best one available, unless the
+ * NRSC5_SIMD environment variable names another available level.
+ */
+int simd_level(void)
+{
+    pthread_once(&simd_once, simd_init);
+    return simd_selected;
+}
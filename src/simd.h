@@ -0,0 +1,18 @@
+#pragma once
+
+/*
+ * Instruction set levels of the SIMD kernels. The Viterbi and FIR code
+ * contain one kernel set per level, built in separate files, and pick the
+ * one matching simd_level() when a decoder or filter is created.
+ */
+enum
+{
+    SIMD_GENERIC,
+    SIMD_SSE3,
+    SIMD_SSE41,
+    SIMD_AVX2,
+    SIMD_AVX512,
+    SIMD_NEON,
+};
+
+int simd_level(void);
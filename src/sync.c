@@ -19,12 +19,16 @@
 #include <string.h>
 
 #include "defines.h"
+#include "equalize.h"
 #include "input.h"
 #include "private.h"
 #include "sync.h"
+#include "vmath.h"
 
-#define MAX_PARTITIONS 14
 #define MIDDLE_REF_SC 30 // midpoint of Table 11-3 in 1011s.pdf
+#define CFO_CANDIDATES 4 // number of CFO candidates to test with detect_cfo()
+#define TRANSPOSE_TILE 8 // subcarriers per tile in push_rows()
+#define MAX_REFS (2 * (MAX_PARTITIONS + 1)) // reference subcarriers in both sidebands
 
 // Table 6-4 in 1011s.pdf
 static const int compatibility_mode[64] = {
@@ -87,10 +91,25 @@ static uint8_t qam64(complex float cf)
     return gray8(crealf(cf)) | (gray8(cimagf(cf)) << 3);
 }
 
-static void adjust_ref(sync_t *st, unsigned int ref, int cfo)
+static inline float complex *subcarrier(sync_t *st, unsigned int k)
 {
-    unsigned int n;
-    float cfo_freq = 2 * M_PI * cfo * CP_FM / FFT_FM;
+    return st->buffer[st->row[k]];
+}
+
+/*
+ * Run the Costas loops of a set of reference subcarriers over a block. The
+ * loops are serial in time but independent of each other, so the samples
+ * and loop state are gathered into one array per quantity, and all of the
+ * loops advance together one symbol at a time. This lets the compiler
+ * vectorize across subcarriers.
+ */
+static void adjust_refs(sync_t *st, const unsigned int *refs, unsigned int count, int cfo)
+{
+    float re[BLKSZ][MAX_REFS], im[BLKSZ][MAX_REFS], ph[BLKSZ][MAX_REFS];
+    float freq[MAX_REFS], phase[MAX_REFS], corr[MAX_REFS];
+    const float cfo_freq = 2 * M_PI * cfo * CP_FM / FFT_FM;
+    const float alpha = st->alpha, beta = st->beta;
+    unsigned int l, n;
 
     // differentially-encoded sync & parity bits
     static const signed char sync[] = {
@@ -98,41 +117,77 @@ static void adjust_ref(sync_t *st, unsigned int ref, int cfo)
         0, 0, 0, 0, -1, 1, -1, 0, 0, 0, 0, 0, 0, 0, 0, -1
     };
 
-    for (n = 0; n < BLKSZ; n++)
+    for (l = 0; l < count; l++)
     {
-        float error = cargf(st->buffer[ref][n] * st->buffer[ref][n] * cexpf(-I * 2 * st->costas_phase[ref])) * 0.5;
-
-        st->phases[ref][n] = st->costas_phase[ref];
-        st->buffer[ref][n] *= cexpf(-I * st->costas_phase[ref]);
+        const unsigned int row = st->row[refs[l]];
 
-        st->costas_freq[ref] += st->beta * error;
-        if (st->costas_freq[ref] > 0.5) st->costas_freq[ref] = 0.5;
-        if (st->costas_freq[ref] < -0.5) st->costas_freq[ref] = -0.5;
-        st->costas_phase[ref] += st->costas_freq[ref] + cfo_freq + (st->alpha * error);
-        if (st->costas_phase[ref] > M_PI) st->costas_phase[ref] -= 2 * M_PI;
-        if (st->costas_phase[ref] < -M_PI) st->costas_phase[ref] += 2 * M_PI;
+        for (n = 0; n < BLKSZ; n++)
+        {
+            re[n][l] = crealf(st->buffer[row][n]);
+            im[n][l] = cimagf(st->buffer[row][n]);
+        }
+        freq[l] = st->costas_freq[row];
+        phase[l] = st->costas_phase[row];
+        corr[l] = 0;
     }
 
-    // compare to sync & parity bits
-    float x = 0;
     for (n = 0; n < BLKSZ; n++)
-        x += crealf(st->buffer[ref][n]) * sync[n];
-    if (x < 0)
     {
+        for (l = 0; l < count; l++)
+        {
+            float c, s, yr, yi, error, f, p;
+
+            // remove the phase estimate
+            fast_sincos(phase[l], &s, &c);
+            yr = re[n][l] * c + im[n][l] * s;
+            yi = im[n][l] * c - re[n][l] * s;
+            ph[n][l] = phase[l];
+            re[n][l] = yr;
+            im[n][l] = yi;
+
+            // squaring removes the BPSK data from the phase error
+            error = fast_atan2(2 * yr * yi, yr * yr - yi * yi) * 0.5f;
+
+            f = freq[l] + beta * error;
+            f = f > 0.5f ? 0.5f : f;
+            f = f < -0.5f ? -0.5f : f;
+            p = wrap_phase(phase[l] + f + cfo_freq + (alpha * error));
+            freq[l] = f;
+            phase[l] = p;
+
+            // compare to sync & parity bits
+            corr[l] += yr * sync[n];
+        }
+    }
+
+    for (l = 0; l < count; l++)
+    {
+        const unsigned int row = st->row[refs[l]];
         // adjust phase by pi to compensate
+        const float flip = corr[l] < 0 ? (float)M_PI : 0;
+        const float sign = corr[l] < 0 ? -1 : 1;
+
         for (n = 0; n < BLKSZ; n++)
         {
-            st->phases[ref][n] += M_PI;
-            st->buffer[ref][n] *= -1;
+            st->buffer[row][n] = CMPLXF(sign * re[n][l], sign * im[n][l]);
+            st->phases[row][n] = ph[n][l] + flip;
         }
-        st->costas_phase[ref] += M_PI;
+        st->costas_freq[row] = freq[l];
+        st->costas_phase[row] = phase[l] + flip;
     }
 }
 
 static void reset_ref(sync_t *st, unsigned int ref)
 {
+    float complex *buf = subcarrier(st, ref);
+    const float *phases = st->phases[st->row[ref]];
+
     for (unsigned int n = 0; n < BLKSZ; n++)
-        st->buffer[ref][n] *= cexpf(I * st->phases[ref][n]);
+    {
+        float s, c;
+        fast_sincos(phases[n], &s, &c);
+        buf[n] = CMPLXF(crealf(buf[n]) * c - cimagf(buf[n]) * s, crealf(buf[n]) * s + cimagf(buf[n]) * c);
+    }
 }
 
 static void decode_dbpsk(const float complex *buf, unsigned char *data, int size)
@@ -176,10 +231,10 @@ static int decode_ref_fm(sync_t *st, unsigned int ref, unsigned int rsid, unsign
 
     for (int n = 0; n < BLKSZ; n++)
         if (needle[n] >= 0)
-            if (needle[n] != (crealf(st->buffer[ref][n]) > 0))
+            if (needle[n] != (crealf(subcarrier(st, ref)[n]) > 0))
                 return -1;
 
-    decode_dbpsk(st->buffer[ref], data, BLKSZ);
+    decode_dbpsk(subcarrier(st, ref), data, BLKSZ);
     *bc = (data[16] << 3) | (data[17] << 2) | (data[18] << 1) | data[19];
     *psmi = (data[25] << 5) | (data[26] << 4) | (data[27] << 3) | (data[28] << 2) | (data[29] << 1) | data[30];
     return 0;
@@ -194,7 +249,7 @@ static int find_ref_fm(sync_t *st, unsigned int ref, unsigned int rsid)
     unsigned char data[BLKSZ];
 
     for (int n = 0; n < BLKSZ; n++)
-        data[n] = crealf(st->buffer[ref][n]) <= 0 ? 0 : 1;
+        data[n] = crealf(subcarrier(st, ref)[n]) <= 0 ? 0 : 1;
 
     int match = fuzzy_match(needle, sizeof(needle), data, BLKSZ);
     if (match >= 0)
@@ -216,7 +271,7 @@ static int find_block_am(sync_t *st, unsigned int ref)
 
     for (int n = 0; n < BLKSZ; n++)
     {
-        data[n] = cimagf(st->buffer[ref][n]) <= 0 ? 0 : 1;
+        data[n] = cimagf(subcarrier(st, ref)[n]) <= 0 ? 0 : 1;
         if ((needle[n] >= 0) && (data[n] != needle[n])) return -1;
     }
 
@@ -246,7 +301,7 @@ static int find_ref_am(sync_t *st, unsigned int ref)
     unsigned char data[BLKSZ];
 
     for (int n = 0; n < BLKSZ; n++)
-        data[n] = cimagf(st->buffer[ref][n]) <= 0 ? 0 : 1;
+        data[n] = cimagf(subcarrier(st, ref)[n]) <= 0 ? 0 : 1;
 
     return fuzzy_match(needle, sizeof(needle), data, BLKSZ);
 }
@@ -256,29 +311,17 @@ static float calc_smag(sync_t *st, unsigned int ref)
     float sum = 0;
     // phase was already corrected, so imaginary component is zero
     for (int n = 0; n < BLKSZ; n++)
-        sum += fabsf(crealf(st->buffer[ref][n]));
+        sum += fabsf(crealf(subcarrier(st, ref)[n]));
     return sum / BLKSZ;
 }
 
 static void adjust_data(sync_t *st, unsigned int lower, unsigned int upper)
 {
-    float smag0, smag19;
-    smag0 = calc_smag(st, lower);
-    smag19 = calc_smag(st, upper);
+    // a partition never straddles two runs of rows
+    const unsigned int row = st->row[lower];
 
-    for (int n = 0; n < BLKSZ; n++)
-    {
-        float complex upper_phase = cexpf(st->phases[upper][n] * I);
-        float complex lower_phase = cexpf(st->phases[lower][n] * I);
-
-        for (int k = 1; k < PARTITION_WIDTH_FM; k++)
-        {
-            // average phase difference
-            float complex C = CMPLXF(PARTITION_WIDTH_FM, PARTITION_WIDTH_FM) / (k * smag19 * upper_phase + (PARTITION_WIDTH_FM - k) * smag0 * lower_phase);
-            // adjust sample
-            st->buffer[lower + k][n] *= C;
-        }
-    }
+    equalize_partition(&st->buffer[row], st->phases[row], st->phases[st->row[upper]],
+                       calc_smag(st, lower), calc_smag(st, upper));
 }
 
 float phase_diff(float a, float b)
@@ -289,56 +332,142 @@ float phase_diff(float a, float b)
     return diff;
 }
 
+/*
+ * Test whether the reference subcarriers line up with their sync patterns
+ * at the given CFO. If at least three of them agree on the block offset,
+ * the CFO and the offset are passed on to acquisition.
+ */
+static int try_cfo(sync_t *st, int cfo)
+{
+    int offset;
+    int best_offset = -1;
+    unsigned int best_count = 0;
+    unsigned int offset_count[BLKSZ];
+    unsigned int refs[MAX_REFS];
+
+    memset(offset_count, 0, BLKSZ * sizeof(unsigned int));
+
+    for (int i = 0; i <= PM_PARTITIONS; i++)
+    {
+        refs[2 * i] = cfo + LB_START + i * PARTITION_WIDTH_FM;
+        refs[2 * i + 1] = cfo + UB_END - i * PARTITION_WIDTH_FM;
+    }
+    adjust_refs(st, refs, 2 * (PM_PARTITIONS + 1), cfo);
+
+    for (int i = 0; i <= PM_PARTITIONS; i++)
+    {
+        offset = find_ref_fm(st, refs[2 * i], (MIDDLE_REF_SC-i) & 0x3);
+        reset_ref(st, refs[2 * i]);
+        if (offset >= 0)
+            offset_count[offset]++;
+
+        offset = find_ref_fm(st, refs[2 * i + 1], (MIDDLE_REF_SC-i) & 0x3);
+        reset_ref(st, refs[2 * i + 1]);
+        if (offset >= 0)
+            offset_count[offset]++;
+    }
+
+    for (offset = 0; offset < BLKSZ; offset++)
+    {
+        if (offset_count[offset] > best_count) {
+            best_offset = offset;
+            best_count = offset_count[offset];
+        }
+    }
+
+    if (best_offset >= 0 && best_count >= 3)
+    {
+        // At least three offsets matched, so this is likely the correct CFO.
+        acquire_keep_extra(&st->input->acq, ((BLKSZ - best_offset) % BLKSZ) * FFTCP_FM);
+        acquire_cfo_adjust(&st->input->acq, cfo);
+
+        // Wait until the buffers have cleared before measuring again.
+        st->cfo_wait = 8;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * How much a subcarrier looks like BPSK, from -1 to 1. Squaring the phase
+ * change between symbols removes the BPSK data, so that only the phase
+ * drift is left, and the QPSK data subcarriers average out. The result is
+ * normalized so that no single subcarrier can dominate.
+ */
+static float complex bpsk_coherence(const float complex *buf)
+{
+    float complex sum = 0;
+    float norm = 0;
+
+    for (int n = 1; n < BLKSZ; n++)
+    {
+        float complex d = buf[n] * conjf(buf[n - 1]);
+        sum += d * d;
+        norm += normf(d);
+    }
+    return norm > 0 ? sum / norm : 0;
+}
+
+/*
+ * Rank the integer CFO candidates by how well the comb of reference
+ * subcarriers matches BPSK at each of them. An offset of cfo subcarriers
+ * also makes the phase drift by cfo_freq per symbol (see adjust_refs()),
+ * which is removed before the coherence is summed. The full pattern test
+ * is then only run on the best candidates.
+ */
 void detect_cfo(sync_t *st)
 {
+    float complex coherence[ROWS_FM];
+    int best_cfo[CFO_CANDIDATES];
+    float best_score[CFO_CANDIDATES];
+    int found = 0;
+
+    for (int r = 0; r < ROWS_FM; r++)
+        coherence[r] = bpsk_coherence(st->buffer[r]);
+
     for (int cfo = -2 * PARTITION_WIDTH_FM; cfo < 2 * PARTITION_WIDTH_FM; cfo++)
     {
-        int offset;
-        int best_offset = -1;
-        unsigned int best_count = 0;
-        unsigned int offset_count[BLKSZ];
-
-        memset(offset_count, 0, BLKSZ * sizeof(unsigned int));
+        float cfo_freq = 2 * M_PI * cfo * CP_FM / FFT_FM;
+        float complex sum = 0;
+        float score;
+        int j;
 
         for (int i = 0; i <= PM_PARTITIONS; i++)
         {
-            adjust_ref(st, cfo + LB_START + i * PARTITION_WIDTH_FM, cfo);
-            offset = find_ref_fm(st, cfo + LB_START + i * PARTITION_WIDTH_FM, (MIDDLE_REF_SC-i) & 0x3);
-            reset_ref(st, cfo + LB_START + i * PARTITION_WIDTH_FM);
-            if (offset >= 0)
-                offset_count[offset]++;
-
-            adjust_ref(st, cfo + UB_END - i * PARTITION_WIDTH_FM, cfo);
-            offset = find_ref_fm(st, cfo + UB_END - i * PARTITION_WIDTH_FM, (MIDDLE_REF_SC-i) & 0x3);
-            reset_ref(st, cfo + UB_END - i * PARTITION_WIDTH_FM);
-            if (offset >= 0)
-                offset_count[offset]++;
+            sum += coherence[st->row[cfo + LB_START + i * PARTITION_WIDTH_FM]];
+            sum += coherence[st->row[cfo + UB_END - i * PARTITION_WIDTH_FM]];
         }
+        score = crealf(sum * cexpf(-I * 2 * cfo_freq));
 
-        for (offset = 0; offset < BLKSZ; offset++)
+        // insert into the list of best candidates, highest score first
+        for (j = found; j > 0 && best_score[j - 1] < score; j--)
         {
-            if (offset_count[offset] > best_count) {
-                best_offset = offset;
-                best_count = offset_count[offset];
+            if (j < CFO_CANDIDATES)
+            {
+                best_score[j] = best_score[j - 1];
+                best_cfo[j] = best_cfo[j - 1];
             }
         }
-
-        if (best_offset >= 0 && best_count >= 3)
+        if (j < CFO_CANDIDATES)
         {
-            // At least three offsets matched, so this is likely the correct CFO.
-            acquire_keep_extra(&st->input->acq, ((BLKSZ - best_offset) % BLKSZ) * FFTCP_FM);
-            acquire_cfo_adjust(&st->input->acq, cfo);
+            best_score[j] = score;
+            best_cfo[j] = cfo;
+            if (found < CFO_CANDIDATES)
+                found++;
+        }
+    }
 
-            // Wait until the buffers have cleared before measuring again.
-            st->cfo_wait = 8;
+    for (int j = 0; j < found; j++)
+    {
+        if (try_cfo(st, best_cfo[j]))
             break;
-        }
     }
 }
 
 void sync_process_fm(sync_t *st)
 {
     int i, partitions_per_band;
+    unsigned int refs[MAX_REFS];
 
     switch (compatibility_mode[st->psmi]) {
         case 2:
@@ -356,11 +485,12 @@ void sync_process_fm(sync_t *st)
             partitions_per_band = 10;
     }
 
-    for (i = 0; i < partitions_per_band * PARTITION_WIDTH_FM + 1; i += PARTITION_WIDTH_FM)
+    for (i = 0; i <= partitions_per_band; i++)
     {
-        adjust_ref(st, LB_START + i, 0);
-        adjust_ref(st, UB_END - i, 0);
+        refs[2 * i] = LB_START + i * PARTITION_WIDTH_FM;
+        refs[2 * i + 1] = UB_END - i * PARTITION_WIDTH_FM;
     }
+    adjust_refs(st, refs, 2 * (partitions_per_band + 1), 0);
 
     // check if we now have synchronization
     if (st->input->sync_state == SYNC_STATE_COARSE)
@@ -405,8 +535,6 @@ void sync_process_fm(sync_t *st)
                 input_set_sync_state(st->input, SYNC_STATE_FINE);
 
                 decode_reset(&st->input->decode);
-
-                frame_reset(&st->input->frame);
             }
         }
         else if (st->cfo_wait == 0)
@@ -430,8 +558,8 @@ void sync_process_fm(sync_t *st)
             adjust_data(st, LB_START + i, LB_START + i + PARTITION_WIDTH_FM);
             adjust_data(st, UB_END - i - PARTITION_WIDTH_FM, UB_END - i);
 
-            samperr += phase_diff(st->phases[LB_START + i][0], st->phases[LB_START + i + PARTITION_WIDTH_FM][0]);
-            samperr += phase_diff(st->phases[UB_END - i - PARTITION_WIDTH_FM][0], st->phases[UB_END - i][0]);
+            samperr += phase_diff(st->phases[st->row[LB_START + i]][0], st->phases[st->row[LB_START + i + PARTITION_WIDTH_FM]][0]);
+            samperr += phase_diff(st->phases[st->row[UB_END - i - PARTITION_WIDTH_FM]][0], st->phases[st->row[UB_END - i]][0]);
         }
         samperr = samperr / (partitions_per_band * 2) * FFT_FM / PARTITION_WIDTH_FM / (2 * M_PI);
 
@@ -440,13 +568,13 @@ void sync_process_fm(sync_t *st)
             float x, y;
 
             x = LB_START + i - (FFT_FM / 2);
-            y = st->costas_freq[LB_START + i];
+            y = st->costas_freq[st->row[LB_START + i]];
             angle += y;
             sum_xy += x * y;
             sum_x2 += x * x;
 
             x = UB_END - i - (FFT_FM / 2);
-            y = st->costas_freq[UB_END - i];
+            y = st->costas_freq[st->row[UB_END - i]];
             angle += y;
             sum_xy += x * y;
             sum_x2 += x * x;
@@ -458,27 +586,28 @@ void sync_process_fm(sync_t *st)
         st->angle = angle;
         for (i = 0; i < partitions_per_band * PARTITION_WIDTH_FM + 1; i += PARTITION_WIDTH_FM)
         {
-            st->costas_freq[LB_START + i] -= angle;
-            st->costas_freq[UB_END - i] -= angle;
+            st->costas_freq[st->row[LB_START + i]] -= angle;
+            st->costas_freq[st->row[UB_END - i]] -= angle;
         }
 
         // Calculate modulation error
         float error_lb = 0, error_ub = 0;
-        for (int n = 0; n < BLKSZ; n++)
+        for (i = 0; i < partitions_per_band * PARTITION_WIDTH_FM; i += PARTITION_WIDTH_FM)
         {
-            float complex c, ideal;
-            for (i = 0; i < partitions_per_band * PARTITION_WIDTH_FM; i += PARTITION_WIDTH_FM)
+            unsigned int j;
+            for (j = 1; j < PARTITION_WIDTH_FM; j++)
             {
-                unsigned int j;
-                for (j = 1; j < PARTITION_WIDTH_FM; j++)
+                const float complex *lower = subcarrier(st, LB_START + i + j);
+                const float complex *upper = subcarrier(st, UB_END - i - PARTITION_WIDTH_FM + j);
+                for (int n = 0; n < BLKSZ; n++)
                 {
-                    c = st->buffer[LB_START + i + j][n];
-                    ideal = CMPLXF(crealf(c) >= 0 ? 1 : -1, cimagf(c) >= 0 ? 1 : -1);
-                    error_lb += normf(ideal - c);
+                    float complex ideal;
+
+                    ideal = CMPLXF(crealf(lower[n]) >= 0 ? 1 : -1, cimagf(lower[n]) >= 0 ? 1 : -1);
+                    error_lb += normf(ideal - lower[n]);
 
-                    c = st->buffer[UB_END - i - PARTITION_WIDTH_FM + j][n];
-                    ideal = CMPLXF(crealf(c) >= 0 ? 1 : -1, cimagf(c) >= 0 ? 1 : -1);
-                    error_ub += normf(ideal - c);
+                    ideal = CMPLXF(crealf(upper[n]) >= 0 ? 1 : -1, cimagf(upper[n]) >= 0 ? 1 : -1);
+                    error_ub += normf(ideal - upper[n]);
                 }
             }
         }
@@ -519,7 +648,7 @@ void sync_process_fm(sync_t *st)
                 unsigned int j;
                 for (j = 1; j < PARTITION_WIDTH_FM; j++)
                 {
-                    c = st->buffer[i + j][n];
+                    c = subcarrier(st, i + j)[n];
                     buffer_pm[out_pm++] = demod(crealf(c), mult_lb);
                     buffer_pm[out_pm++] = demod(cimagf(c), mult_lb);
                 }
@@ -529,7 +658,7 @@ void sync_process_fm(sync_t *st)
                 unsigned int j;
                 for (j = 1; j < PARTITION_WIDTH_FM; j++)
                 {
-                    c = st->buffer[i + j][n];
+                    c = subcarrier(st, i + j)[n];
                     buffer_pm[out_pm++] = demod(crealf(c), mult_ub);
                     buffer_pm[out_pm++] = demod(cimagf(c), mult_ub);
                 }
@@ -538,13 +667,13 @@ void sync_process_fm(sync_t *st)
                 unsigned int j;
                 for (j = 1; j < PARTITION_WIDTH_FM; j++)
                 {
-                    c = st->buffer[LB_START + (PM_PARTITIONS * PARTITION_WIDTH_FM) + j][n];
+                    c = subcarrier(st, LB_START + (PM_PARTITIONS * PARTITION_WIDTH_FM) + j)[n];
                     buffer_px1[out_px1++] = demod(crealf(c), mult_lb);
                     buffer_px1[out_px1++] = demod(cimagf(c), mult_lb);
                 }
                 for (j = 1; j < PARTITION_WIDTH_FM; j++)
                 {
-                    c = st->buffer[UB_END - (PM_PARTITIONS + 1) * PARTITION_WIDTH_FM + j][n];
+                    c = subcarrier(st, UB_END - (PM_PARTITIONS + 1) * PARTITION_WIDTH_FM + j)[n];
                     buffer_px1[out_px1++] = demod(crealf(c), mult_ub);
                     buffer_px1[out_px1++] = demod(cimagf(c), mult_ub);
                 }
@@ -555,7 +684,7 @@ void sync_process_fm(sync_t *st)
                     unsigned int j;
                     for (j = 1; j < PARTITION_WIDTH_FM; j++)
                     {
-                        c = st->buffer[i + j][n];
+                        c = subcarrier(st, i + j)[n];
                         buffer_px1[out_px1++] = demod(crealf(c), mult_lb);
                         buffer_px1[out_px1++] = demod(cimagf(c), mult_lb);
                     }
@@ -565,7 +694,7 @@ void sync_process_fm(sync_t *st)
                     unsigned int j;
                     for (j = 1; j < PARTITION_WIDTH_FM; j++)
                     {
-                        c = st->buffer[i + j][n];
+                        c = subcarrier(st, i + j)[n];
                         buffer_px1[out_px1++] = demod(crealf(c), mult_ub);
                         buffer_px1[out_px1++] = demod(cimagf(c), mult_ub);
                     }
@@ -577,7 +706,7 @@ void sync_process_fm(sync_t *st)
                     unsigned int j;
                     for (j = 1; j < PARTITION_WIDTH_FM; j++)
                     {
-                        c = st->buffer[i + j][n];
+                        c = subcarrier(st, i + j)[n];
                         buffer_px2[out_px2++] = demod(crealf(c), mult_lb);
                         buffer_px2[out_px2++] = demod(cimagf(c), mult_lb);
                     }
@@ -587,7 +716,7 @@ void sync_process_fm(sync_t *st)
                     unsigned int j;
                     for (j = 1; j < PARTITION_WIDTH_FM; j++)
                     {
-                        c = st->buffer[i + j][n];
+                        c = subcarrier(st, i + j)[n];
                         buffer_px2[out_px2++] = demod(crealf(c), mult_lb);
                         buffer_px2[out_px2++] = demod(cimagf(c), mult_lb);
                     }
@@ -617,7 +746,7 @@ void sync_process_am(sync_t *st)
     {
         for (int n = 0; n < BLKSZ; n++)
         {
-            st->buffer[CENTER_AM - i][n] = -conjf(st->buffer[CENTER_AM - i][n]);
+            subcarrier(st, CENTER_AM - i)[n] = -conjf(subcarrier(st, CENTER_AM - i)[n]);
         }
     }
 
@@ -627,7 +756,7 @@ void sync_process_am(sync_t *st)
         {
             for (int n = 0; n < BLKSZ; n++)
             {
-                st->buffer[CENTER_AM + i][n] += st->buffer[CENTER_AM - i][n];
+                subcarrier(st, CENTER_AM + i)[n] += subcarrier(st, CENTER_AM - i)[n];
             }
         }
     }
@@ -660,7 +789,6 @@ void sync_process_am(sync_t *st)
             st->bc = 0;
             input_set_sync_state(st->input, SYNC_STATE_FINE);
             decode_reset(&st->input->decode);
-            frame_reset(&st->input->frame);
             st->offset_history = 0;
         }
     }
@@ -670,21 +798,21 @@ void sync_process_am(sync_t *st)
         const int pids1_index = (st->psmi != SERVICE_MODE_MA3) ? PIDS_INNER_INDEX_AM : -PIDS_INNER_INDEX_AM;
         const int pids2_index = (st->psmi != SERVICE_MODE_MA3) ? PIDS_OUTER_INDEX_AM : PIDS_INNER_INDEX_AM;
 
-        const float complex pids1_mult = 2 * CMPLXF(1.5, -0.5) / (st->buffer[CENTER_AM + pids1_index][8] + st->buffer[CENTER_AM + pids1_index][24]);
-        const float complex pids2_mult = 2 * CMPLXF(1.5, -0.5) / (st->buffer[CENTER_AM + pids2_index][8] + st->buffer[CENTER_AM + pids2_index][24]);
+        const float complex pids1_mult = 2 * CMPLXF(1.5, -0.5) / (subcarrier(st, CENTER_AM + pids1_index)[8] + subcarrier(st, CENTER_AM + pids1_index)[24]);
+        const float complex pids2_mult = 2 * CMPLXF(1.5, -0.5) / (subcarrier(st, CENTER_AM + pids2_index)[8] + subcarrier(st, CENTER_AM + pids2_index)[24]);
         uint8_t pids[2 * BLKSZ];
         int pids_out = 0;
 
         for (int n = 0; n < BLKSZ; n++)
         {
-            st->buffer[CENTER_AM + pids1_index][n] *= pids1_mult;
-            pids[pids_out++] = qam16(st->buffer[CENTER_AM + pids1_index][n]);
+            subcarrier(st, CENTER_AM + pids1_index)[n] *= pids1_mult;
+            pids[pids_out++] = qam16(subcarrier(st, CENTER_AM + pids1_index)[n]);
 
-            st->buffer[CENTER_AM + pids2_index][n] *= pids2_mult;
-            pids[pids_out++] = qam16(st->buffer[CENTER_AM + pids2_index][n]);
+            subcarrier(st, CENTER_AM + pids2_index)[n] *= pids2_mult;
+            pids[pids_out++] = qam16(subcarrier(st, CENTER_AM + pids2_index)[n]);
         }
 
-        decode_process_pids_am(&st->input->decode, pids);
+        decode_push_pids_am(&st->input->decode, pids);
 
         float complex pl_mult[PARTITION_WIDTH_AM];
         float complex pu_mult[PARTITION_WIDTH_AM];
@@ -701,23 +829,23 @@ void sync_process_am(sync_t *st)
             int train1 = (5 + 11*col) % 32;
             int train2 = (21 + 11*col) % 32;
 
-            pl_mult[col] = 2 * CMPLXF(2.5, -2.5) / (st->buffer[CENTER_AM - primary_index - col][train1] + st->buffer[CENTER_AM - primary_index - col][train2]);
-            pu_mult[col] = 2 * CMPLXF(2.5, -2.5) / (st->buffer[CENTER_AM + primary_index + col][train1] + st->buffer[CENTER_AM + primary_index + col][train2]);
+            pl_mult[col] = 2 * CMPLXF(2.5, -2.5) / (subcarrier(st, CENTER_AM - primary_index - col)[train1] + subcarrier(st, CENTER_AM - primary_index - col)[train2]);
+            pu_mult[col] = 2 * CMPLXF(2.5, -2.5) / (subcarrier(st, CENTER_AM + primary_index + col)[train1] + subcarrier(st, CENTER_AM + primary_index + col)[train2]);
             if (st->psmi != SERVICE_MODE_MA3)
             {
-                s_mult[col] = 2 * CMPLXF(1.5, -0.5) / (st->buffer[CENTER_AM + secondary_index + col][train1] + st->buffer[CENTER_AM + secondary_index + col][train2]);
-                t_mult[col] = 2 * CMPLXF(-0.5, 0.5) / (st->buffer[CENTER_AM + tertiary_index + col][train1] + st->buffer[CENTER_AM + tertiary_index + col][train2]);
+                s_mult[col] = 2 * CMPLXF(1.5, -0.5) / (subcarrier(st, CENTER_AM + secondary_index + col)[train1] + subcarrier(st, CENTER_AM + secondary_index + col)[train2]);
+                t_mult[col] = 2 * CMPLXF(-0.5, 0.5) / (subcarrier(st, CENTER_AM + tertiary_index + col)[train1] + subcarrier(st, CENTER_AM + tertiary_index + col)[train2]);
             }
             else
             {
-                s_mult[col] = 2 * CMPLXF(2.5, -2.5) / (st->buffer[CENTER_AM + secondary_index + col][train1] + st->buffer[CENTER_AM + secondary_index + col][train2]);
-                t_mult[col] = 2 * CMPLXF(2.5, -2.5) / (st->buffer[CENTER_AM - tertiary_index - col][train1] + st->buffer[CENTER_AM - tertiary_index - col][train2]);
+                s_mult[col] = 2 * CMPLXF(2.5, -2.5) / (subcarrier(st, CENTER_AM + secondary_index + col)[train1] + subcarrier(st, CENTER_AM + secondary_index + col)[train2]);
+                t_mult[col] = 2 * CMPLXF(2.5, -2.5) / (subcarrier(st, CENTER_AM - tertiary_index - col)[train1] + subcarrier(st, CENTER_AM - tertiary_index - col)[train2]);
             }
 
             if (col > 0)
             {
-                samperr += phase_diff(cargf(pl_mult[col]), cargf(pl_mult[col-1]));
-                samperr += phase_diff(cargf(pu_mult[col]), cargf(pu_mult[col-1]));
+                samperr += phase_diff(fast_cargf(pl_mult[col]), fast_cargf(pl_mult[col-1]));
+                samperr += phase_diff(fast_cargf(pu_mult[col]), fast_cargf(pu_mult[col-1]));
             }
         }
         samperr = samperr / (2 * (PARTITION_WIDTH_AM-1)) * FFT_AM / (2 * M_PI);
@@ -732,27 +860,27 @@ void sync_process_am(sync_t *st)
         {
             for (int col = 0; col < PARTITION_WIDTH_AM; col++)
             {
-                st->buffer[CENTER_AM - primary_index - col][n] *= pl_mult[col];
-                st->buffer[CENTER_AM + primary_index + col][n] *= pu_mult[col];
-                st->buffer[CENTER_AM + secondary_index + col][n] *= s_mult[col];
+                subcarrier(st, CENTER_AM - primary_index - col)[n] *= pl_mult[col];
+                subcarrier(st, CENTER_AM + primary_index + col)[n] *= pu_mult[col];
+                subcarrier(st, CENTER_AM + secondary_index + col)[n] *= s_mult[col];
                 if (st->psmi != SERVICE_MODE_MA3)
-                    st->buffer[CENTER_AM + tertiary_index + col][n] *= t_mult[col];
+                    subcarrier(st, CENTER_AM + tertiary_index + col)[n] *= t_mult[col];
                 else
-                    st->buffer[CENTER_AM - tertiary_index - col][n] *= t_mult[col];
+                    subcarrier(st, CENTER_AM - tertiary_index - col)[n] *= t_mult[col];
 
                 if (st->psmi != SERVICE_MODE_MA3)
                 {
-                    pl[n * PARTITION_WIDTH_AM + col] = qam64(st->buffer[CENTER_AM - primary_index - col][n]);
-                    pu[n * PARTITION_WIDTH_AM + col] = qam64(st->buffer[CENTER_AM + primary_index + col][n]);
-                    s[n * PARTITION_WIDTH_AM + col] = qam16(st->buffer[CENTER_AM + secondary_index + col][n]);
-                    t[n * PARTITION_WIDTH_AM + col] = qpsk(st->buffer[CENTER_AM + tertiary_index + col][n]);
+                    pl[n * PARTITION_WIDTH_AM + col] = qam64(subcarrier(st, CENTER_AM - primary_index - col)[n]);
+                    pu[n * PARTITION_WIDTH_AM + col] = qam64(subcarrier(st, CENTER_AM + primary_index + col)[n]);
+                    s[n * PARTITION_WIDTH_AM + col] = qam16(subcarrier(st, CENTER_AM + secondary_index + col)[n]);
+                    t[n * PARTITION_WIDTH_AM + col] = qpsk(subcarrier(st, CENTER_AM + tertiary_index + col)[n]);
                 }
                 else
                 {
-                    pl[n * PARTITION_WIDTH_AM + col] = qam64(st->buffer[CENTER_AM - primary_index - col][n]);
-                    pu[n * PARTITION_WIDTH_AM + col] = qam64(st->buffer[CENTER_AM + primary_index + col][n]);
-                    s[n * PARTITION_WIDTH_AM + col] = qam64(st->buffer[CENTER_AM + secondary_index + col][n]);
-                    t[n * PARTITION_WIDTH_AM + col] = qam64(st->buffer[CENTER_AM - tertiary_index - col][n]);
+                    pl[n * PARTITION_WIDTH_AM + col] = qam64(subcarrier(st, CENTER_AM - primary_index - col)[n]);
+                    pu[n * PARTITION_WIDTH_AM + col] = qam64(subcarrier(st, CENTER_AM + primary_index + col)[n]);
+                    s[n * PARTITION_WIDTH_AM + col] = qam64(subcarrier(st, CENTER_AM + secondary_index + col)[n]);
+                    t[n * PARTITION_WIDTH_AM + col] = qam64(subcarrier(st, CENTER_AM - tertiary_index - col)[n]);
                 }
             }
         }
@@ -771,46 +899,90 @@ void sync_adjust(sync_t *st, int sample_adj)
     int i;
     for (i = 0; i < MAX_PARTITIONS * PARTITION_WIDTH_FM + 1; i++)
     {
-        st->costas_phase[LB_START + i] -= sample_adj * (LB_START + i - (FFT_FM / 2)) * 2 * M_PI / FFT_FM;
-        st->costas_phase[UB_END - i] -= sample_adj * (UB_END - i - (FFT_FM / 2)) * 2 * M_PI / FFT_FM;
+        st->costas_phase[st->row[LB_START + i]] -= sample_adj * (LB_START + i - (FFT_FM / 2)) * 2 * M_PI / FFT_FM;
+        st->costas_phase[st->row[UB_END - i]] -= sample_adj * (UB_END - i - (FFT_FM / 2)) * 2 * M_PI / FFT_FM;
     }
 }
 
-void sync_push(sync_t *st, float complex *fftout)
+/*
+ * Copy a run of consecutive subcarriers from a batch of FFT outputs into
+ * their rows. This is a transpose, so it is done a few subcarriers at a
+ * time to keep the rows being written in cache.
+ */
+static void push_rows(sync_t *st, const float complex *fftout, unsigned int fft, unsigned int symbols,
+                      unsigned int first, unsigned int count)
 {
-    unsigned int i;
+    const unsigned int row = st->row[first];
 
-    if (st->input->radio->mode == NRSC5_MODE_FM)
-    {
-        for (i = 0; i < MAX_PARTITIONS * PARTITION_WIDTH_FM + 1; i++)
-        {
-            st->buffer[LB_START + i][st->idx] = fftout[LB_START + i];
-            st->buffer[UB_END - i][st->idx] = fftout[UB_END - i];
-        }
-    }
-    else
+    for (unsigned int i = 0; i < count; i += TRANSPOSE_TILE)
     {
-        for (i = CENTER_AM - MAX_INDEX_AM; i <= CENTER_AM + MAX_INDEX_AM; i++)
+        const unsigned int width = (count - i < TRANSPOSE_TILE) ? count - i : TRANSPOSE_TILE;
+
+        for (unsigned int n = 0; n < symbols; n++)
         {
-            st->buffer[i][st->idx] = fftout[i];
+            const float complex *in = &fftout[n * fft + first + i];
+            for (unsigned int j = 0; j < width; j++)
+                st->buffer[row + i + j][st->idx + n] = in[j];
         }
     }
+}
+
+void sync_push(sync_t *st, const float complex *fftout, unsigned int symbols)
+{
+    const unsigned int fft = (st->input->radio->mode == NRSC5_MODE_FM) ? FFT_FM : FFT_AM;
 
-    if (++st->idx == BLKSZ)
+    while (symbols > 0)
     {
-        st->idx = 0;
+        const unsigned int n = (symbols < BLKSZ - st->idx) ? symbols : BLKSZ - st->idx;
 
         if (st->input->radio->mode == NRSC5_MODE_FM)
-            sync_process_fm(st);
+        {
+            push_rows(st, fftout, fft, n, LB_START - 2 * PARTITION_WIDTH_FM, SIDEBAND_ROWS_FM);
+            push_rows(st, fftout, fft, n, UB_END - MAX_PARTITIONS * PARTITION_WIDTH_FM, SIDEBAND_ROWS_FM);
+        }
         else
-            sync_process_am(st);
+        {
+            push_rows(st, fftout, fft, n, CENTER_AM - MAX_INDEX_AM, ROWS_AM);
+        }
+
+        fftout += n * fft;
+        symbols -= n;
+        st->idx += n;
+
+        if (st->idx == BLKSZ)
+        {
+            st->idx = 0;
+
+            if (st->input->radio->mode == NRSC5_MODE_FM)
+                sync_process_fm(st);
+            else
+                sync_process_am(st);
+        }
     }
 }
 
 void sync_reset(sync_t *st)
 {
     unsigned int i;
+
+    // unused subcarriers share the spare row
     for (i = 0; i < FFT_FM; i++)
+        st->row[i] = SYNC_ROWS;
+    if (st->input->radio->mode == NRSC5_MODE_FM)
+    {
+        for (i = 0; i < SIDEBAND_ROWS_FM; i++)
+        {
+            st->row[LB_START - 2 * PARTITION_WIDTH_FM + i] = i;
+            st->row[UB_END - MAX_PARTITIONS * PARTITION_WIDTH_FM + i] = SIDEBAND_ROWS_FM + i;
+        }
+    }
+    else
+    {
+        for (i = 0; i < ROWS_AM; i++)
+            st->row[CENTER_AM - MAX_INDEX_AM + i] = i;
+    }
+
+    for (i = 0; i < SYNC_ROWS + 1; i++)
     {
         st->costas_freq[i] = 0;
         st->costas_phase[i] = 0;
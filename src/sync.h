@@ -4,11 +4,25 @@
 
 #include <complex.h>
 
+#define MAX_PARTITIONS 14
+
+/*
+ * Only the subcarriers in use are kept, one row each. An FM sideband needs
+ * every partition up to MP11 plus two partitions of margin on the outer
+ * edge for the CFO search. AM needs the subcarriers out to MAX_INDEX_AM.
+ * Subcarriers that are not in use all map to a spare row at the end.
+ */
+#define SIDEBAND_ROWS_FM (2 * PARTITION_WIDTH_FM + MAX_PARTITIONS * PARTITION_WIDTH_FM + 1)
+#define ROWS_FM (2 * SIDEBAND_ROWS_FM)
+#define ROWS_AM (2 * MAX_INDEX_AM + 1)
+#define SYNC_ROWS (ROWS_FM > ROWS_AM ? ROWS_FM : ROWS_AM)
+
 typedef struct
 {
     struct input_t *input;
-    float complex buffer[FFT_FM][BLKSZ];
-    float phases[FFT_FM][BLKSZ];
+    unsigned short row[FFT_FM];
+    float complex buffer[SYNC_ROWS + 1][BLKSZ];
+    float phases[SYNC_ROWS + 1][BLKSZ];
     unsigned int idx;
     int psmi;
     int pli;
@@ -23,8 +37,8 @@ typedef struct
 
     float alpha;
     float beta;
-    float costas_freq[FFT_FM];
-    float costas_phase[FFT_FM];
+    float costas_freq[SYNC_ROWS + 1];
+    float costas_phase[SYNC_ROWS + 1];
 
     int mer_cnt;
     float error_lb;
@@ -32,6 +46,6 @@ typedef struct
 } sync_t;
 
 void sync_adjust(sync_t *st, int sample_adj);
-void sync_push(sync_t *st, float complex *fft);
+void sync_push(sync_t *st, const float complex *fftout, unsigned int symbols);
 void sync_reset(sync_t *st);
 void sync_init(sync_t *st, struct input_t *input);
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <complex.h>
+#include <float.h>
+#include <math.h>
+
+/*
+ * Fast replacements for the libm functions used in the demodulator's
+ * per-sample and per-subcarrier loops. They are written without branches,
+ * so that loops calling them can be vectorized, which glibc's cexpf() and
+ * cargf() prevent. GCC will not turn a select between floating point
+ * operations into a blend, since the operations could trap, so conditions
+ * are turned into 0 or 1 and used as factors instead.
+ *
+ * Maximum absolute errors against libm, for arguments within [-3pi, 3pi],
+ * as checked by tests/vmath_accuracy.c:
+ *   fast_sincos, fast_cexpi    4e-7
+ *   fast_atan2, fast_cargf     3e-6
+ */
+
+// Wrap a phase to [-pi, pi]. Exact multiples of 2 pi are removed while x is small.
+static inline float wrap_phase(float x)
+{
+    return x - (int)(x * (float)(0.5 / M_PI) + copysignf(0.5f, x)) * (float)(2 * M_PI);
+}
+
+// Sine and cosine, with Taylor series on [-pi/2, pi/2].
+static inline void fast_sincos(float x, float *s, float *c)
+{
+    x = wrap_phase(x);
+    const float fold = fabsf(x) > (float)(M_PI / 2);
+    x += fold * (copysignf((float)M_PI, x) - 2 * x);
+
+    const float x2 = x * x;
+    *s = x * (1 + x2 * (-1.0f / 6 + x2 * (1.0f / 120 + x2 * (-1.0f / 5040 + x2 * (1.0f / 362880 + x2 * (-1.0f / 39916800))))));
+    *c = (1 - 2 * fold) * (1 + x2 * (-0.5f + x2 * (1.0f / 24 + x2 * (-1.0f / 720 + x2 * (1.0f / 40320 + x2 * (-1.0f / 3628800 + x2 * (1.0f / 479001600)))))));
+}
+
+// Four-quadrant arctangent. Returns 0 for (0, 0), like atan2f().
+static inline float fast_atan2(float y, float x)
+{
+    const float ax = fabsf(x), ay = fabsf(y);
+    const float swap = ay > ax;
+    const float a = (ax > ay ? ay : ax) / ((ax > ay ? ax : ay) + FLT_MIN);
+    const float a2 = a * a;
+    float r;
+
+    r = a * (0.99997726f + a2 * (-0.33262347f + a2 * (0.19354346f + a2 * (-0.11643287f + a2 * (0.05265332f + a2 * -0.01172120f)))));
+    r += swap * ((float)(M_PI / 2) - 2 * r);
+    r += (float)(x < 0) * ((float)M_PI - 2 * r);
+    return copysignf(r, y);
+}
+
+// cexpf(I * x)
+static inline float complex fast_cexpi(float x)
+{
+    float s, c;
+    fast_sincos(x, &s, &c);
+    return CMPLXF(c, s);
+}
+
+// cargf(z)
+static inline float fast_cargf(float complex z)
+{
+    return fast_atan2(cimagf(z), crealf(z));
+}
@@ -958,6 +958,11 @@ class NRSC5:
         NRSC5.libnrsc5.nrsc5_alert_category_name(category.value, ctypes.byref(name))
         return name.value.decode()
 
+    def set_fftw_wisdom_file(self, path):
+        result = NRSC5.libnrsc5.nrsc5_set_fftw_wisdom_file(path.encode() if path is not None else None)
+        if result != 0:
+            raise NRSC5Error("Failed to load FFTW wisdom.")
+
     def open(self, device_index):
         result = NRSC5.libnrsc5.nrsc5_open(ctypes.byref(self.radio), device_index)
         if result != 0:
@@ -996,7 +1001,21 @@ class NRSC5:
 
     def set_mode(self, mode):
         self._check_session()
-        NRSC5.libnrsc5.nrsc5_set_mode(self.radio, mode.value)
+        result = NRSC5.libnrsc5.nrsc5_set_mode(self.radio, mode.value)
+        if result != 0:
+            raise NRSC5Error("Failed to set mode.")
+
+    def set_fec_threads(self, threads):
+        self._check_session()
+        result = NRSC5.libnrsc5.nrsc5_set_fec_threads(self.radio, threads)
+        if result != 0:
+            raise NRSC5Error("Failed to set FEC threads.")
+
+    def set_ber_interval(self, interval):
+        self._check_session()
+        result = NRSC5.libnrsc5.nrsc5_set_ber_interval(self.radio, ctypes.c_uint(interval))
+        if result != 0:
+            raise NRSC5Error("Failed to set BER interval.")
 
     def set_bias_tee(self, on):
         self._check_session()
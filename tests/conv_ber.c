@@ -0,0 +1,152 @@
+/*
+ * Bit error rate and speed of the K=7 Viterbi decoder
+ *
+ * Random P1 frames are encoded, punctured to rate 2/5 and sent over an
+ * AWGN channel as 8-bit soft bits, then decoded. The program is built once
+ * with int16 path metrics and once with CONV_METRIC_8BIT, and fails if the
+ * decoded BER exceeds the limit of any noise level. Set NRSC5_SIMD to
+ * measure a particular kernel set.
+ *
+ * usage: conv_ber_i16|conv_ber_u8 [frames per noise level]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+
+#include "conv.h"
+#include "defines.h"
+
+#define SOFT_AMPLITUDE 100
+
+#ifdef CONV_METRIC_8BIT
+#define METRIC_NAME "8-bit"
+#else
+#define METRIC_NAME "int16"
+#endif
+
+/*
+ * Noise levels and BER limits. The limits are about twice the BER measured
+ * with either metric width, so that a broken kernel fails while the 8-bit
+ * quantization loss does not.
+ */
+static const struct
+{
+    float sigma;
+    double max_ber;
+} levels[] = {
+    { 70, 5e-5 },
+    { 80, 1e-3 },
+    { 90, 1.2e-2 },
+    { 100, 7e-2 },
+};
+
+static const uint8_t punc_2_5[] = { 1, 1, 1, 1, 1, 0 };
+static const unsigned int gen[] = { 0133, 0171, 0165 };
+
+static uint64_t rng_state = 0x853c49e6748fea9bULL;
+
+static uint32_t rng_next(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state >> 32;
+}
+
+// standard normal deviate, Box-Muller
+static float gauss(void)
+{
+    double u1 = (rng_next() + 1.0) / 4294967297.0;
+    double u2 = rng_next() / 4294967296.0;
+    return sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+// tail-biting K=7 encoder with rate 2/5 puncturing, to noisy soft bits
+static void encode(const uint8_t *bits, unsigned int len, float sigma, int8_t *out)
+{
+    unsigned int r = 0, i, j = 0, k;
+
+    for (i = len - 6; i < len; i++)
+        r = (r >> 1) | (bits[i] << 6);
+
+    for (i = 0; i < len; i++)
+    {
+        r = (r >> 1) | (bits[i] << 6);
+        for (k = 0; k < 3; k++, j++)
+        {
+            float v;
+
+            if (!punc_2_5[j % sizeof(punc_2_5)])
+                continue;
+
+            v = (__builtin_parity(r & gen[k]) ? SOFT_AMPLITUDE : -SOFT_AMPLITUDE) + sigma * gauss();
+            if (v > 127)
+                v = 127;
+            if (v < -127)
+                v = -127;
+            *out++ = (int8_t) lrintf(v);
+        }
+    }
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[])
+{
+    const unsigned int len = P1_FRAME_LEN_FM;
+    unsigned int frames = (argc > 1) ? atoi(argv[1]) : 10;
+    unsigned int l, f, i;
+    uint8_t *bits = malloc(len);
+    uint8_t *out = malloc(len);
+    int8_t *coded = malloc(P1_FRAME_LEN_ENCODED_FM);
+    struct vdecoder *dec = nrsc5_conv_alloc_p1();
+    int failed = 0;
+
+    if (!bits || !out || !coded || !dec || frames == 0)
+        return 1;
+
+    printf("%s path metrics, %u P1 frames per level\n", METRIC_NAME, frames);
+    printf("sigma  BER        limit      Mbit/s\n");
+
+    for (l = 0; l < sizeof(levels) / sizeof(levels[0]); l++)
+    {
+        unsigned long errors = 0;
+        double elapsed = 0, ber;
+
+        for (f = 0; f < frames; f++)
+        {
+            double start;
+
+            for (i = 0; i < len; i++)
+                bits[i] = rng_next() & 1;
+            encode(bits, len, levels[l].sigma, coded);
+
+            start = now();
+            nrsc5_conv_decode(dec, coded, out, len);
+            elapsed += now() - start;
+
+            for (i = 0; i < len; i++)
+                errors += (out[i] != bits[i]);
+        }
+
+        ber = (double) errors / ((double) len * frames);
+        printf("%5.0f  %-9.3g  %-9.3g  %6.1f%s\n", levels[l].sigma, ber, levels[l].max_ber,
+               len * frames / elapsed * 1e-6, (ber > levels[l].max_ber) ? "  FAIL" : "");
+        if (ber > levels[l].max_ber)
+            failed = 1;
+    }
+
+    nrsc5_conv_free(dec);
+    free(coded);
+    free(out);
+    free(bits);
+    return failed;
+}
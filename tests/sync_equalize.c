@@ -0,0 +1,88 @@
+/*
+ * Data subcarrier equalizer against the complex division it replaced
+ *
+ * equalize_partition() is run on random partitions and compared with the
+ * original per-sample computation, which used cexpf() and a complex
+ * division. The phase difference between the two reference subcarriers is
+ * kept within +/- pi/2, as for a real channel, so that the interpolated
+ * channel never nears zero and the comparison stays well conditioned.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "equalize.h"
+
+#define PARTITIONS 256
+
+// largest error allowed, relative to the magnitude of the reference result
+#define TOLERANCE 5e-6
+
+static uint64_t rng_state = 0x2545f4914f6cdd1dULL;
+
+// uniform in [lo, hi)
+static float uniform(float lo, float hi)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return lo + (hi - lo) * (float) ((rng_state >> 40) / 16777216.0);
+}
+
+int main(void)
+{
+    static float complex rows[PARTITION_WIDTH_FM + 1][BLKSZ];
+    static float complex ref[PARTITION_WIDTH_FM + 1][BLKSZ];
+    float lower_phases[BLKSZ], upper_phases[BLKSZ];
+    double max_error = 0;
+
+    for (int p = 0; p < PARTITIONS; p++)
+    {
+        const float smag0 = uniform(0.2f, 2.0f);
+        const float smag19 = uniform(0.2f, 2.0f);
+
+        for (int n = 0; n < BLKSZ; n++)
+        {
+            lower_phases[n] = uniform(-3 * M_PI, 3 * M_PI);
+            upper_phases[n] = lower_phases[n] + uniform(-M_PI / 2, M_PI / 2);
+        }
+
+        for (int k = 0; k <= PARTITION_WIDTH_FM; k++)
+        {
+            for (int n = 0; n < BLKSZ; n++)
+            {
+                rows[k][n] = CMPLXF(uniform(-2, 2), uniform(-2, 2));
+                ref[k][n] = rows[k][n];
+            }
+        }
+
+        for (int n = 0; n < BLKSZ; n++)
+        {
+            float complex upper_phase = cexpf(I * upper_phases[n]);
+            float complex lower_phase = cexpf(I * lower_phases[n]);
+
+            for (int k = 1; k < PARTITION_WIDTH_FM; k++)
+            {
+                float complex C = CMPLXF(PARTITION_WIDTH_FM, PARTITION_WIDTH_FM) / (k * smag19 * upper_phase + (PARTITION_WIDTH_FM - k) * smag0 * lower_phase);
+                ref[k][n] *= C;
+            }
+        }
+
+        equalize_partition(rows, lower_phases, upper_phases, smag0, smag19);
+
+        for (int k = 0; k <= PARTITION_WIDTH_FM; k++)
+        {
+            for (int n = 0; n < BLKSZ; n++)
+            {
+                const double error = cabsf(rows[k][n] - ref[k][n]) / cabsf(ref[k][n]);
+
+                if (error > max_error)
+                    max_error = error;
+            }
+        }
+    }
+
+    printf("%d partitions, max relative error %.3g (tolerance %.3g)%s\n", PARTITIONS, max_error, TOLERANCE,
+           (max_error > TOLERANCE) ? "  FAIL" : "");
+    return max_error > TOLERANCE;
+}
@@ -0,0 +1,105 @@
+/*
+ * Accuracy of the fast math functions in src/vmath.h against libm
+ *
+ * Fails if an error exceeds the bound documented in vmath.h, or if a zero
+ * or axis case gives a different result than atan2f().
+ */
+
+#include <stdio.h>
+
+#include "vmath.h"
+
+#define SINCOS_BOUND 4e-7
+#define ATAN2_BOUND 3e-6
+
+#define SWEEP_POINTS 2000000
+
+static int failed;
+
+static void check(const char *name, double error, double bound)
+{
+    printf("%-12s max error %.3g (bound %.3g)%s\n", name, error, bound, (error > bound) ? "  FAIL" : "");
+    if (error > bound)
+        failed = 1;
+}
+
+// distance between two angles, so that pi and -pi are equal
+static double angle_error(float a, float b)
+{
+    double d = fabs((double) a - b);
+    return (d > M_PI) ? 2 * M_PI - d : d;
+}
+
+static void check_sincos(void)
+{
+    double err_sincos = 0, err_cexpi = 0;
+    int i;
+
+    for (i = 0; i <= SWEEP_POINTS; i++)
+    {
+        const float x = (float) (-3 * M_PI + 6 * M_PI * i / SWEEP_POINTS);
+        float s, c;
+        float complex z;
+
+        fast_sincos(x, &s, &c);
+        err_sincos = fmax(err_sincos, fmax(fabsf(s - sinf(x)), fabsf(c - cosf(x))));
+
+        z = fast_cexpi(x);
+        err_cexpi = fmax(err_cexpi, fmax(fabsf(cimagf(z) - sinf(x)), fabsf(crealf(z) - cosf(x))));
+    }
+
+    check("fast_sincos", err_sincos, SINCOS_BOUND);
+    check("fast_cexpi", err_cexpi, SINCOS_BOUND);
+}
+
+static void check_atan2(void)
+{
+    static const float scales[] = { 1e-20f, 1e-3f, 1, 1e3f, 1e20f };
+    double err_atan2 = 0, err_cargf = 0;
+    unsigned int i, j;
+
+    // every angle of a circle, at magnitudes far from 1
+    for (j = 0; j < sizeof(scales) / sizeof(scales[0]); j++)
+    {
+        for (i = 0; i <= SWEEP_POINTS / 4; i++)
+        {
+            const double t = -3 * M_PI + 6 * M_PI * i / (SWEEP_POINTS / 4);
+            const float y = (float) (scales[j] * sin(t));
+            const float x = (float) (scales[j] * cos(t));
+
+            err_atan2 = fmax(err_atan2, angle_error(fast_atan2(y, x), atan2f(y, x)));
+            err_cargf = fmax(err_cargf, angle_error(fast_cargf(CMPLXF(x, y)), cargf(CMPLXF(x, y))));
+        }
+    }
+
+    // zeros and the axes of every quadrant, where the result must be exact
+    {
+        static const float axes[][2] = {
+            { 0.0f, 0.0f }, { -0.0f, 0.0f },
+            { 0.0f, 1.0f }, { -0.0f, 1.0f }, { 0.0f, -1.0f }, { -0.0f, -1.0f },
+            { 1.0f, 0.0f }, { -1.0f, 0.0f }, { 1.0f, -0.0f }, { -1.0f, -0.0f },
+        };
+
+        for (i = 0; i < sizeof(axes) / sizeof(axes[0]); i++)
+        {
+            const float y = axes[i][0], x = axes[i][1];
+            const float got = fast_atan2(y, x), want = atan2f(y, x);
+
+            if (fabsf(got - want) > ATAN2_BOUND || signbit(got) != signbit(want))
+            {
+                printf("fast_atan2(%g, %g) = %g, atan2f gives %g  FAIL\n", y, x, got, want);
+                failed = 1;
+            }
+        }
+    }
+
+    check("fast_atan2", err_atan2, ATAN2_BOUND);
+    check("fast_cargf", err_cargf, ATAN2_BOUND);
+}
+
+int main(void)
+{
+    check_sincos();
+    check_atan2();
+    return failed;
+}